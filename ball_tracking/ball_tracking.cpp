@@ -34,3 +34,130 @@ void getRoiRect(Point position, Size frame_size, Rect& roi) {
     roi.height = y_max - y_min;
 }
 
+
+
+BallTracker::BallTracker(Size frame_size)
+    : reduced_roi(false), ball_found(false), frame_size(frame_size),
+      undistort_frames(false), use_table_mask(false) {
+}
+
+/**
+    Undistort the frames (the remap tables are computed with the first frame)
+
+    @param cameraMatrix The camera matrix, from the calibration settings
+    @param distortionCoeffs The distortion coefficients, from the calibration settings
+    @param calibration_size The size of the pictures used for the calibration
+*/
+void BallTracker::useCalibration(const Mat& cameraMatrix, const Mat& distortionCoeffs, Size calibration_size) {
+    this->cameraMatrix = cameraMatrix;
+    this->distortionCoeffs = distortionCoeffs;
+    this->calibration_size = calibration_size;
+    map1.release();
+    map2.release();
+    undistort_frames = true;
+}
+
+/**
+    Search the ball only on the table and around it when it is lost
+
+    @param table_corners The four corners of the table
+    @param corners_image_size The size of the picture where the corners were found
+*/
+void BallTracker::useTableMask(const vector<Point2f>& table_corners, Size corners_image_size) {
+    this->table_corners = table_corners;
+    this->corners_image_size = corners_image_size;
+    mask.frame_size = Size();
+    use_table_mask = true;
+}
+
+/**
+    Search the ball in a new frame of the video
+
+    @param input The frame, as given by the camera
+    @return true if the ball was found, its position is then the last one of 'positions'
+*/
+bool BallTracker::processFrame(const Mat& input) {
+    // TEMPORARY: we reduce frame size
+    if (undistort_frames) {
+        // the undistortion and the resize are done in a single pass,
+        // with remap tables computed once for the video resolution
+        if (map1.empty())
+            initFusedMaps(cameraMatrix, distortionCoeffs, calibration_size,
+                          input.size(), frame_size, map1, map2);
+        fusedRemap(input, map1, map2, frame);
+    }
+    else
+        resize(input, frame, frame_size, 0, 0, INTER_CUBIC);
+
+    // if we found the ball during previous iteration, we use these coordinates
+    // as centre of a reduced ROI, else the ROI is the full frame
+    // (or the zone of the table, if we know it and if it is in the frame)
+    Mat roi;
+    reduced_roi = ball_found;
+    if (reduced_roi) {
+        getRoiRect(positions.back(), frame_size, roi_rect);
+        roi = Mat(frame, roi_rect);
+    }
+    else {
+        roi_rect = Rect(Point(0, 0), frame_size);
+        roi = frame;
+    }
+
+    bool masked = false;
+    if (!reduced_roi && use_table_mask) {
+        if (mask.frame_size != frame_size)
+            buildTableMask(table_corners, corners_image_size, frame_size, mask);
+        masked = !mask.bands.empty();
+    }
+
+    if (masked) {
+        // we blur and binarize only the pixels of the table and its margin,
+        // and the detection works on the bounding box of the table
+        maskedGaussianBlur(frame, mask, frame_blurred);
+        maskedThresholdSegmentation(frame_blurred, mask, frame_binarized);
+        roi_rect = mask.bbox;
+        roi_binarized = isolatedRoi(frame_binarized, roi_rect);
+    }
+    else {
+        // we blur the picture to remove the noise
+        GaussianBlur(roi, roi_blurred, Size(BLUR_KERNEL_LENGTH, BLUR_KERNEL_LENGTH), 0, 0);
+
+        // with a threshold segmentation
+        thresholdSegmentation(roi_blurred, roi_binarized);
+    }
+
+    ball_found = false;
+    Point ball_position;
+
+    // ===== first try =====
+    // with a Hough transform on the binarized picture
+    detectBallWithHough(roi_binarized, roi_rect, circles);
+
+    // if the number of circles found by the Hough transform is exactly 1,
+    // we accept that circle as the correct ball position
+    if (circles.size() == 1) {
+        ball_found = true;
+        ball_position = Point(circles[0][0], circles[0][1]);
+    }
+
+    if (ball_found == false) {
+        // ===== second try =====
+        // we use OpenCV convex hull algorithm to detect shapes
+        // (the ball is not detected by Hough transform if it is not round enough)
+        vector<Point> possible_positions;
+        detectBallWithContours(roi_binarized, roi_rect, possible_positions);
+
+        // if the number of positions found by the Hough transform is exactly 1,
+        // we accept that position as the correct ball position
+        if (possible_positions.size() == 1) {
+            ball_found = true;
+            ball_position = possible_positions[0];
+        }
+    }
+
+    // if we have found the ball position, we save it in the history
+    if (ball_found == true)
+        positions.push_back(ball_position);
+
+    return ball_found;
+}
@@ -6,9 +6,50 @@
 #include <iostream>
 
 #include "constants.h"
+#include "ball_segmentation.h"
+#include "ball_detection.h"
+#include "frame_preprocessing.h"
+#include "table_mask.h"
+
+// the size of the frames processed by the tracker (TEMPORARY: the frames are reduced)
+const Size TRACKING_FRAME_SIZE(640, 480);
 
 
 void getRoiRect(Point position, Size frame_size, Rect& roi);
 
 
-#endif
\ No newline at end of file
+// the tracking of the ball, one frame after the other: the state kept from the previous
+// frames (the ROI around the last position) and the buffers reused for each frame
+class BallTracker {
+public:
+    BallTracker(Size frame_size = TRACKING_FRAME_SIZE);
+
+    void useCalibration(const Mat& cameraMatrix, const Mat& distortionCoeffs, Size calibration_size);
+    void useTableMask(const vector<Point2f>& table_corners, Size corners_image_size);
+    bool processFrame(const Mat& input);
+
+    Mat frame;                // the last frame, undistorted and resized
+    Rect roi_rect;            // the zone where the ball was searched in the last frame
+    bool reduced_roi;         // whether that zone was reduced around the previous position
+    vector<Vec3f> circles;    // the circles found by the Hough transform in the last frame
+    vector<Point> positions;  // the history of all detected positions (0 or 1 per frame)
+    bool ball_found;          // whether we found the ball in the last frame
+
+private:
+    Size frame_size;
+
+    bool undistort_frames;
+    Mat cameraMatrix, distortionCoeffs, map1, map2;
+    Size calibration_size;
+
+    bool use_table_mask;
+    vector<Point2f> table_corners;
+    Size corners_image_size;
+    table_mask mask;
+
+    Mat roi_blurred, roi_binarized;
+    Mat frame_blurred, frame_binarized;  // full frame buffers, used with the table mask
+};
+
+
+#endif
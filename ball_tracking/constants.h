@@ -7,7 +7,11 @@ using namespace cv;
 using namespace std;
 
 
-#define SHOW_WINDOWS  // if defined, display a window with image result for each step
+// if defined, display a window with image result for each step
+// (not defined when compiled with -DHEADLESS, like in the capture benchmark)
+#ifndef HEADLESS
+    #define SHOW_WINDOWS
+#endif
 
 // we use only orange balls, like RGB = [255, 252, 31]
 // For this color, HSV is [30, 224, 255]
@@ -27,5 +31,11 @@ const int BALL_SIZE = 10;  // pixels
 const int ROI_WIDTH  = BALL_SIZE * 15;
 const int ROI_HEIGHT = BALL_SIZE * 7;
 
+// when the ball is lost, we search it only on the table and around it:
+// the table is dilated by this margin (pixels), because the ball can be above the table
+const int TABLE_MASK_MARGIN = BALL_SIZE * 8;
+// the rows of the table mask are processed by bands of this height
+const int TABLE_MASK_BAND_ROWS = 16;
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "frame_preprocessing.h"
+
+using namespace std;
+using namespace cv;
+
+
+/**
+    Load the camera parameters from the XML file written by the camera calibration program
+
+    @param filename The XML calibration settings filename
+    @param cameraMatrix The output camera matrix
+    @param distortionCoeffs The output distortion coefficients
+    @param calibration_size The output size of the pictures used for the calibration
+    @return false if the file could not be read
+*/
+bool loadCalibration(const string& filename, Mat& cameraMatrix, Mat& distortionCoeffs, Size& calibration_size) {
+    FileStorage fs;
+    fs.open(filename, FileStorage::READ);
+    if (!fs.isOpened())
+        return false;
+
+    fs["Camera_Matrix"] >> cameraMatrix;
+    fs["Distortion_Coefficients"] >> distortionCoeffs;
+    int image_width = 0, image_height = 0;
+    fs["image_Width"] >> image_width;
+    fs["image_Height"] >> image_height;
+    calibration_size = Size(image_width, image_height);
+
+    return !cameraMatrix.empty() && image_width > 0 && image_height > 0;
+}
+
+// scales a camera matrix, as if the picture was resized by (sx, sy)
+// (we use the center of the pixels as reference, like the resize function)
+static Mat scaleCameraMatrix(const Mat& cameraMatrix, double sx, double sy) {
+    Mat scaled;
+    cameraMatrix.convertTo(scaled, CV_64F);
+    scaled.at<double>(0,0) *= sx;
+    scaled.at<double>(0,1) *= sx;
+    scaled.at<double>(0,2) = (scaled.at<double>(0,2) + 0.5) * sx - 0.5;
+    scaled.at<double>(1,1) *= sy;
+    scaled.at<double>(1,2) = (scaled.at<double>(1,2) + 0.5) * sy - 0.5;
+    return scaled;
+}
+
+/**
+    Compute the remap tables which undistort and resize a frame in a single pass:
+    each pixel of the output (at the working resolution) gets the coordinates
+    of the pixel to sample in the distorted source frame
+
+    @param cameraMatrix The camera matrix, from the calibration file
+    @param distortionCoeffs The distortion coefficients, from the calibration file
+    @param calibration_size The size of the pictures used for the calibration
+    @param frame_size The size of the frames of the video
+    @param output_size The working resolution
+    @param map1 The output first remap table (fixed-point coordinates)
+    @param map2 The output second remap table (interpolation coefficients)
+*/
+void initFusedMaps(const Mat& cameraMatrix, const Mat& distortionCoeffs, Size calibration_size,
+                   Size frame_size, Size output_size, Mat& map1, Mat& map2) {
+    // the video may not have the same resolution as the calibration pictures
+    Mat frameCameraMatrix = scaleCameraMatrix(cameraMatrix,
+                                              (double)frame_size.width  / calibration_size.width,
+                                              (double)frame_size.height / calibration_size.height);
+
+    // same camera matrix as the distortion correction program, so the results are comparable
+    Mat newCameraMatrix = getOptimalNewCameraMatrix(frameCameraMatrix, distortionCoeffs, frame_size, 0.5);
+
+    // we fold the resize into the new camera matrix: the undistorted picture is directly
+    // computed at the working resolution, without an intermediate full size picture
+    Mat outputCameraMatrix = scaleCameraMatrix(newCameraMatrix,
+                                               (double)output_size.width  / frame_size.width,
+                                               (double)output_size.height / frame_size.height);
+
+    initUndistortRectifyMap(frameCameraMatrix, distortionCoeffs, Mat(), outputCameraMatrix,
+                            output_size, CV_16SC2, map1, map2);
+}
+
+
+// remaps a group of tiles of the output
+class FusedRemapBody : public ParallelLoopBody {
+public:
+    FusedRemapBody(const Mat& frame, const Mat& map1, const Mat& map2, Mat& output)
+        : frame(frame), map1(map1), map2(map2), output(output) {}
+
+    void operator()(const Range& range) const {
+        for (int tile = range.start; tile < range.end; tile++) {
+            Range rows(tile * PREPROCESSING_TILE_ROWS,
+                       min((tile + 1) * PREPROCESSING_TILE_ROWS, output.rows));
+
+            // the output matrix is already allocated, so remap writes directly into it, without copy
+            Mat tile_output = output.rowRange(rows);
+            remap(frame, tile_output, map1.rowRange(rows), map2.rowRange(rows), INTER_LINEAR);
+        }
+    }
+
+private:
+    const Mat& frame;
+    const Mat& map1;
+    const Mat& map2;
+    Mat& output;
+};
+
+/**
+    Undistort and resize a frame in a single pass over the memory, by tiles processed in parallel
+
+    @param frame The distorted frame, at full resolution
+    @param map1 The first remap table computed by initFusedMaps
+    @param map2 The second remap table computed by initFusedMaps
+    @param output The output frame (BGR), at the working resolution
+*/
+void fusedRemap(const Mat& frame, const Mat& map1, const Mat& map2, Mat& output) {
+    output.create(map1.size(), CV_8UC3);
+
+    int nb_tiles = (output.rows + PREPROCESSING_TILE_ROWS - 1) / PREPROCESSING_TILE_ROWS;
+    parallel_for_(Range(0, nb_tiles), FusedRemapBody(frame, map1, map2, output));
+}
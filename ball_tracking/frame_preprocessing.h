@@ -0,0 +1,23 @@
+#ifndef FRAME_PREPROCESSING_H
+#define FRAME_PREPROCESSING_H
+
+#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/calib3d/calib3d.hpp"
+#include <iostream>
+
+#include "constants.h"
+
+// number of output rows remapped together by a thread
+// (the fused pass outputs only BGR: the frame must be blurred before the conversion
+// to HSV, and the blur can't be fused in the remap, see README.md)
+const int PREPROCESSING_TILE_ROWS = 16;
+
+
+bool loadCalibration(const string& filename, Mat& cameraMatrix, Mat& distortionCoeffs, Size& calibration_size);
+void initFusedMaps(const Mat& cameraMatrix, const Mat& distortionCoeffs, Size calibration_size,
+                   Size frame_size, Size output_size, Mat& map1, Mat& map2);
+void fusedRemap(const Mat& frame, const Mat& map1, const Mat& map2, Mat& output);
+
+
+#endif
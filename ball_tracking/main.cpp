@@ -6,6 +6,8 @@
 #include "ball_segmentation.h"
 #include "ball_detection.h"
 #include "ball_tracking.h"
+#include "frame_preprocessing.h"
+#include "table_mask.h"
 
 using namespace cv;
 using namespace std;
@@ -25,6 +27,31 @@ int main(int argc, char const *argv[])
     }
     const string videofilename = argv[1];
 
+    BallTracker tracker;
+
+    // if a calibration settings (XML) filename is given, the frames are undistorted
+    if (argc >= 3 && string(argv[2]) != "-") {
+        Mat cameraMatrix, distortionCoeffs;
+        Size calibration_size;
+        if (!loadCalibration(argv[2], cameraMatrix, distortionCoeffs, calibration_size)) {
+            cerr << "Error when reading calibration settings file" << endl;
+            exit(1);
+        }
+        tracker.useCalibration(cameraMatrix, distortionCoeffs, calibration_size);
+    }
+
+    // if a table corners (YAML) filename is given, the ball is searched only on the table
+    // and around it when it is lost
+    if (argc >= 4) {
+        vector<Point2f> table_corners;
+        Size corners_image_size;
+        if (!loadTableCorners(argv[3], table_corners, corners_image_size)) {
+            cerr << "Error when reading table corners file" << endl;
+            exit(1);
+        }
+        tracker.useTableMask(table_corners, corners_image_size);
+    }
+
     // we open the video file
     VideoCapture capture(videofilename);
     if (!capture.isOpened()) {
@@ -33,14 +60,7 @@ int main(int argc, char const *argv[])
     }
 
 
-    Mat frame, roi_blurred, roi_binarized;
-    Rect roi;
-    vector<Vec3f> circles;
-
-    // we save info from previous iterations
-    Mat frame_previous;  // the previous frame
-    vector<Point> positions;  // the history of all detected positions (0 or 1 per frame)
-    bool ball_found_prev = false;  // whether we found ball during previous iteration
+    Mat frame;
 
     int i = 0;
     while(true)
@@ -51,9 +71,6 @@ int main(int argc, char const *argv[])
             continue;
         }
 
-        bool ball_found = false;
-        Point ball_position;
-
         // we grab a new frame
         capture >> frame;
 
@@ -61,72 +78,20 @@ int main(int argc, char const *argv[])
         if(frame.empty())
             break;
 
-        // TEMPORARY: we reduce frame size
-        Size temp_size(640, 480);
-        resize(frame, frame, temp_size, 0, 0, INTER_CUBIC);
-
-        // if we found the ball during previous iteration, we use these coordinates
-        // as centre of a reduced ROI, else the ROI is the full frame
-        Mat roi;
-        Rect roi_rect;
-        if (ball_found_prev) {
-            getRoiRect(positions.back(), temp_size, roi_rect);
-            roi = Mat(frame, roi_rect);
-        }
-        else
-            roi = frame;
-
-        // we blur the picture to remove the noise
-        GaussianBlur(roi, roi_blurred, Size(BLUR_KERNEL_LENGTH, BLUR_KERNEL_LENGTH), 0, 0);
-
-        // ===== first try =====
-        // with a threshold segmentation and a Hough transform
-        thresholdSegmentation(roi_blurred, roi_binarized);
-        detectBallWithHough(roi_binarized, roi_rect, circles);
-
-        // if the number of circles found by the Hough transform is exactly 1,
-        // we accept that circle as the correct ball position
-        if (circles.size() == 1) {
-            ball_found = true;
-            ball_position = Point(circles[0][0], circles[0][1]);
-            #ifdef SHOW_WINDOWS
-                drawHoughCircles(frame, circles);
-            #endif
-        }
-
-        if (ball_found == false) {
-            // ===== second try =====
-            // we use OpenCV convex hull algorithm to detect shapes
-            // (the ball is not detected by Hough transform if it is not round enough)
-            vector<Point> possible_positions;
-            detectBallWithContours(roi_binarized, roi_rect, possible_positions);
-
-            // if the number of positions found by the Hough transform is exactly 1,
-            // we accept that position as the correct ball position
-            if (possible_positions.size() == 1) {
-                ball_found = true;
-                ball_position = possible_positions[0];
-            }
-        }
-
-
-        // if we have found the ball position, we save it in the history
-        if (ball_found == true)
-            positions.push_back(ball_position);
+        // we search the ball in the frame (see ball_tracking.cpp)
+        tracker.processFrame(frame);
 
         #ifdef SHOW_WINDOWS
             // we display the image
-            if (ball_found_prev)
-                drawTrackingInfo(frame, positions, roi_rect);
+            if (tracker.circles.size() == 1)
+                drawHoughCircles(tracker.frame, tracker.circles);
+            if (tracker.reduced_roi)
+                drawTrackingInfo(tracker.frame, tracker.positions, tracker.roi_rect);
             else
-                drawTrackingInfo(frame, positions);
-            imshow(videofilename, frame);
+                drawTrackingInfo(tracker.frame, tracker.positions);
+            imshow(videofilename, tracker.frame);
         #endif
 
-        // we save the previous frame
-        frame_previous = frame;
-        ball_found_prev = ball_found;
-
         // press 'q' to quit
         char key = waitKey(1);
         if (key == 'q')
@@ -0,0 +1,200 @@
+#include "table_mask.h"
+
+#include <string.h>
+
+using namespace std;
+using namespace cv;
+
+
+/**
+    Load the corners of the table from the YAML file written by the table lines detection
+    programs (hough-transform or table-tracker)
+
+    @param filename The YAML filename
+    @param corners The output corners: left up, right up, right down, left down
+    @param image_size The output size of the picture where the corners were found
+    @return false if the file could not be read
+*/
+bool loadTableCorners(const string& filename, vector<Point2f>& corners, Size& image_size) {
+    FileStorage fs;
+    fs.open(filename, FileStorage::READ);
+    if (!fs.isOpened())
+        return false;
+
+    int image_width = 0, image_height = 0;
+    fs["Image_Width"] >> image_width;
+    fs["Image_Height"] >> image_height;
+    image_size = Size(image_width, image_height);
+    fs["Table_Corners"] >> corners;
+
+    return corners.size() == 4 && image_size.width > 0 && image_size.height > 0;
+}
+
+/**
+    Compute the zone where the ball is searched: the quadrilateral of the table, dilated
+    by TABLE_MASK_MARGIN, stored as one span of pixels per row
+
+    @param corners The corners of the table
+    @param image_size The size of the picture where the corners were found
+    @param frame_size The working resolution of the ball tracking
+    @param mask The output mask
+*/
+void buildTableMask(const vector<Point2f>& corners, Size image_size, Size frame_size, table_mask& mask) {
+    // the corners are scaled to the working resolution
+    vector<Point> polygon;
+    for (size_t i = 0; i < corners.size(); i++)
+        polygon.push_back(Point(cvRound(corners[i].x * frame_size.width  / image_size.width),
+                                cvRound(corners[i].y * frame_size.height / image_size.height)));
+
+    // the mask is drawn once, and only its spans are kept
+    // (a convex polygon dilated by a disk stays convex)
+    Mat pixels = Mat::zeros(frame_size, CV_8U);
+    fillConvexPoly(pixels, &polygon[0], (int)polygon.size(), Scalar(COLOR_WHITE));
+    dilate(pixels, pixels, getStructuringElement(MORPH_ELLIPSE,
+                                                 Size(2*TABLE_MASK_MARGIN + 1, 2*TABLE_MASK_MARGIN + 1)));
+
+    mask.frame_size = frame_size;
+    mask.spans.assign(frame_size.height, row_span());
+    int y_min = frame_size.height, y_max = -1, x_min = frame_size.width, x_max = -1;
+    for (int y = 0; y < frame_size.height; y++) {
+        const uchar* row = pixels.ptr<uchar>(y);
+        int x_start = 0;
+        while (x_start < frame_size.width && row[x_start] == COLOR_BLACK)
+            x_start++;
+        int x_end = frame_size.width;
+        while (x_end > x_start && row[x_end - 1] == COLOR_BLACK)
+            x_end--;
+
+        mask.spans[y].x_start = x_start;
+        mask.spans[y].x_end = x_end;
+        if (x_end > x_start) {
+            y_min = MIN(y_min, y);
+            y_max = y;
+            x_min = MIN(x_min, x_start);
+            x_max = MAX(x_max, x_end);
+        }
+    }
+    mask.bbox = y_max < 0 ? Rect() : Rect(x_min, y_min, x_max - x_min, y_max - y_min + 1);
+
+    // the bands: OpenCV functions are called on rectangles, so we group the rows
+    // to have few calls, each one on a rectangle not much bigger than its spans
+    mask.bands.clear();
+    for (int y = mask.bbox.y; y < mask.bbox.y + mask.bbox.height; y += TABLE_MASK_BAND_ROWS) {
+        int y_end = MIN(y + TABLE_MASK_BAND_ROWS, mask.bbox.y + mask.bbox.height);
+        int band_start = frame_size.width, band_end = 0;
+        for (int i = y; i < y_end; i++) {
+            if (mask.spans[i].x_end > mask.spans[i].x_start) {
+                band_start = MIN(band_start, mask.spans[i].x_start);
+                band_end = MAX(band_end, mask.spans[i].x_end);
+            }
+        }
+        if (band_end > band_start)
+            mask.bands.push_back(Rect(band_start, y, band_end - band_start, y_end - y));
+    }
+}
+
+// sets to black the pixels of the bands which are not in the spans
+static void clearOutsideSpans(const table_mask& mask, Mat& binarized) {
+    for (size_t b = 0; b < mask.bands.size(); b++) {
+        const Rect& band = mask.bands[b];
+        for (int y = band.y; y < band.y + band.height; y++) {
+            uchar* row = binarized.ptr<uchar>(y);
+            const row_span& span = mask.spans[y];
+            int x_start = span.x_end > span.x_start ? span.x_start : band.x + band.width;
+            for (int x = band.x; x < x_start; x++)
+                row[x] = COLOR_BLACK;
+            for (int x = MAX(span.x_end, x_start); x < band.x + band.width; x++)
+                row[x] = COLOR_BLACK;
+        }
+    }
+}
+
+// sets to black the pixels of the bounding box which are not in the bands,
+// so the binarized frame doesn't need to be cleared
+static void clearOutsideBands(const table_mask& mask, Mat& binarized) {
+    const Rect& bbox = mask.bbox;
+    int y = bbox.y;
+    for (size_t b = 0; b <= mask.bands.size(); b++) {
+        // the rows between the previous band and this one (none, the table being convex)
+        int band_y = b < mask.bands.size() ? mask.bands[b].y : bbox.y + bbox.height;
+        for (; y < band_y; y++)
+            memset(binarized.ptr<uchar>(y) + bbox.x, COLOR_BLACK, bbox.width);
+        if (b == mask.bands.size())
+            break;
+
+        // the pixels of the bounding box on the left and on the right of the band
+        const Rect& band = mask.bands[b];
+        for (; y < band.y + band.height; y++) {
+            uchar* row = binarized.ptr<uchar>(y);
+            memset(row + bbox.x, COLOR_BLACK, band.x - bbox.x);
+            memset(row + band.x + band.width, COLOR_BLACK, bbox.x + bbox.width - band.x - band.width);
+        }
+    }
+}
+
+/**
+    Give a header on the pixels of a ROI which doesn't know the frame around them: the OpenCV
+    filters (morphology, Canny...) read the pixels around a ROI of a frame, but the pixels
+    of the binarized frame outside of the bounding box of the mask are not computed
+
+    @param frame The frame
+    @param roi The rectangle of the ROI, inside of the frame
+    @return The ROI, which shares its pixels with the frame
+*/
+Mat isolatedRoi(const Mat& frame, Rect roi) {
+    return Mat(roi.height, roi.width, frame.type(), (void*)(frame.ptr(roi.y) + roi.x * frame.elemSize()), frame.step);
+}
+
+/**
+    Blur only the bands of the mask: the pixels near the border of a band are blurred
+    with the pixels of the frame around it, so the result in the bands is the same as
+    the blur of the full frame. The other pixels of the output are not computed
+
+    @param frame The frame (BGR)
+    @param mask The zone of the table
+    @param blurred The output blurred frame (same size as the frame)
+*/
+void maskedGaussianBlur(const Mat& frame, const table_mask& mask, Mat& blurred) {
+    blurred.create(frame.size(), frame.type());
+    for (size_t b = 0; b < mask.bands.size(); b++) {
+        Mat band_blurred(blurred, mask.bands[b]);
+        GaussianBlur(Mat(frame, mask.bands[b]), band_blurred,
+                     Size(BLUR_KERNEL_LENGTH, BLUR_KERNEL_LENGTH), 0, 0);
+    }
+}
+
+/**
+    Apply the segmentation with a threshold based on the color of the ball (like
+    thresholdSegmentation) only on the pixels of the mask: the color conversion and
+    the threshold are done on the bands, and the closing on the bounding box of the mask
+
+    @param blurred The frame blurred (at least in the bands), formatted as BGR
+    @param mask The zone of the table
+    @param binarized The output binarized frame (black outside of the mask in its bounding box,
+                     the pixels outside of the bounding box are not computed)
+*/
+void maskedThresholdSegmentation(const Mat& blurred, const table_mask& mask, Mat& binarized) {
+    // only the pixels of the bounding box are written: the buffer is not cleared for each frame
+    binarized.create(blurred.size(), CV_8U);
+    if (mask.bands.empty())
+        return;
+
+    Mat band_hsv;
+    for (size_t b = 0; b < mask.bands.size(); b++) {
+        Mat band_binarized(binarized, mask.bands[b]);
+        cvtColor(Mat(blurred, mask.bands[b]), band_hsv, CV_BGR2HSV);
+        inRange(band_hsv, BALL_COLOR_HSV_MIN, BALL_COLOR_HSV_MAX, band_binarized);
+    }
+    clearOutsideSpans(mask, binarized);
+    clearOutsideBands(mask, binarized);
+
+    // (the pixels outside of the bounding box are not initialized, so we display only the bounding box)
+    Mat bbox_binarized = isolatedRoi(binarized, mask.bbox);
+    #ifdef SHOW_WINDOWS
+        imshow("threshold segmentation", bbox_binarized);
+    #endif
+
+    // we apply a closing (dilatation then erosion) on the bounding box
+    morphologyEx(bbox_binarized, bbox_binarized, MORPH_CLOSE,
+                getStructuringElement(MORPH_ELLIPSE, Size(CLOSING_KERNEL_LENGTH,CLOSING_KERNEL_LENGTH)));
+}
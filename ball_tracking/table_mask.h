@@ -0,0 +1,33 @@
+#ifndef TABLE_MASK_H
+#define TABLE_MASK_H
+
+#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <iostream>
+
+#include "constants.h"
+#include "ball_segmentation.h"
+
+// the pixels of a row of the mask: from x_start (included) to x_end (excluded)
+// (the table with its margin is convex, so there is at most one span per row)
+typedef struct {
+    int x_start, x_end;
+} row_span;
+
+// the zone where the ball is searched when it is lost: the table and a margin around it
+typedef struct {
+    Size frame_size;
+    vector<row_span> spans;  // one span per row of the frame (empty if x_start == x_end)
+    vector<Rect> bands;      // groups of TABLE_MASK_BAND_ROWS rows, each one as wide as its widest span
+    Rect bbox;               // bounding box of the mask
+} table_mask;
+
+
+bool loadTableCorners(const string& filename, vector<Point2f>& corners, Size& image_size);
+void buildTableMask(const vector<Point2f>& corners, Size image_size, Size frame_size, table_mask& mask);
+void maskedGaussianBlur(const Mat& frame, const table_mask& mask, Mat& blurred);
+void maskedThresholdSegmentation(const Mat& blurred, const table_mask& mask, Mat& binarized);
+Mat isolatedRoi(const Mat& frame, Rect roi);
+
+
+#endif
@@ -5,12 +5,22 @@
 #include <sstream>
 #include <time.h>
 #include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/calib3d/calib3d.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include "chessboard_detection.h"
+#include "frame_selection.h"
+#include "corner_cache.h"
+
 #ifndef _CRT_SECURE_NO_WARNINGS
 # define _CRT_SECURE_NO_WARNINGS
 #endif
@@ -21,7 +31,9 @@ using namespace std;
 static void help()
 {
     cout <<  "This is a camera calibration sample." << endl
-         <<  "Usage: ./camera-calibration [configurationFile.xml]"  << endl
+         <<  "Usage: ./camera-calibration [configurationFile.xml] [--headless]"  << endl
+         <<  "With --headless, the pictures of an image list are processed in parallel, "
+             "without display, and the calibration is run at the end." << endl
          <<  "Near the sample file you'll find the configuration file, which has detailed help of "
              "how to edit it.  It may be any OpenCV supported file format XML/YAML." << endl;
 }
@@ -41,8 +53,14 @@ public:
     Pattern calibrationPattern;// One of the Chessboard, circles, or asymmetric circle pattern
     float squareSize;          // The size of a square in your defined unit (point, millimeter,etc).
     int nrFrames;              // The number of frames to use from the input for calibration
+    bool selectFrames;         // Select the frames by sharpness, motion and coverage (see frame_selection.h)
+    bool incremental;          // Calibrate in the background while capturing (see BackgroundCalibrator)
+    int incrementalStep;       // Number of captured frames between two background calibrations
     float aspectRatio;         // The aspect ratio
     int delay;                 // In case of a video input
+    bool skim;                 // For a video file, only decode one frame every "delay" milliseconds of video
+    int skimStride;            // The number of frames between two decoded frames in skim mode
+    bool cornerCache;          // For an image list, keep the detected points in a cache (see corner_cache.h)
     bool bwritePoints;         //  Write detected feature points
     bool bwriteExtrinsics;     // Write extrinsic parameters
     bool calibZeroTangentDist; // Assume zero tangential distortion
@@ -56,6 +74,7 @@ public:
     vector<string> imageList;
     int atImageList;
     VideoCapture inputCapture;
+    Mat frameBuffer;           // The last frame of the video or camera, reused for each frame
     InputType inputType;
     bool goodInput;
     int flag;  // flags for the calibration
@@ -71,6 +90,9 @@ public:
                   << "Square_Size"         << squareSize
                   << "Calibrate_Pattern" << patternToUse
                   << "Calibrate_NrOfFrameToUse" << nrFrames
+                  << "Calibrate_SelectFrames" << selectFrames
+                  << "Calibrate_Incremental" << incremental
+                  << "Calibrate_IncrementalStep" << incrementalStep
                   << "Calibrate_FixAspectRatio" << aspectRatio
                   << "Calibrate_AssumeZeroTangentialDistortion" << calibZeroTangentDist
                   << "Calibrate_FixPrincipalPointAtTheCenter" << calibFixPrincipalPoint
@@ -83,6 +105,8 @@ public:
 
                   << "Input_FlipAroundHorizontalAxis" << flipVertical
                   << "Input_Delay" << delay
+                  << "Input_Skim" << skim
+                  << "Input_CornerCache" << cornerCache
                   << "Input" << input
            << "}";
     }
@@ -96,6 +120,9 @@ public:
         node["Calibrate_Pattern"] >> patternToUse;
         node["Square_Size"]  >> squareSize;
         node["Calibrate_NrOfFrameToUse"] >> nrFrames;
+        node["Calibrate_SelectFrames"] >> selectFrames;
+        node["Calibrate_Incremental"] >> incremental;
+        node["Calibrate_IncrementalStep"] >> incrementalStep;
         node["Calibrate_FixAspectRatio"] >> aspectRatio;
         node["Write_DetectedFeaturePoints"] >> bwritePoints;
         node["Write_extrinsicParameters"] >> bwriteExtrinsics;
@@ -106,6 +133,8 @@ public:
         node["Show_UndistortedImage"] >> showUndistorsed;
         node["Input"] >> input;
         node["Input_Delay"] >> delay;
+        node["Input_Skim"] >> skim;
+        node["Input_CornerCache"] >> cornerCache;
         interprate(); // to check the input data
     }
 
@@ -128,6 +157,8 @@ public:
             cerr << "Invalid number of frames " << nrFrames << endl;
             goodInput = false;
         }
+        if (incrementalStep <= 0)
+            incrementalStep = 1;
 
         if (input.empty()) {    // Check for valid input
             inputType = INVALID;
@@ -167,6 +198,21 @@ public:
                 inputType = INVALID;
         }
 
+        // in skim mode, the frames of the video which are closer than "delay" milliseconds
+        // to the last decoded frame are skipped without being decoded
+        skimStride = 1;
+        if (skim && inputType != VIDEO_FILE)
+        {
+            cerr << "Input_Skim is only used with a video file, it is ignored" << endl;
+            skim = false;
+        }
+        if (skim)
+        {
+            double fps = inputCapture.get(CV_CAP_PROP_FPS);
+            if (fps > 0)
+                skimStride = max(1, cvRound(delay * 1e-3 * fps));
+        }
+
         // NB: |= is bitwise OR (only add bits)
         flag = 0;
         if(calibFixPrincipalPoint) flag |= CV_CALIB_FIX_PRINCIPAL_POINT;
@@ -189,14 +235,23 @@ public:
 
     // we get the next image from the input
     // NB: this shouldn't be in a "Settings" class !?
+    // the frames of a video or a camera are decoded in frameBuffer, which is reused
+    // (and overwritten) at each call, so the previous image must not be used after it
     Mat nextImage()
     {
         Mat result;
         if( inputCapture.isOpened() )
         {
-            Mat view0;
-            inputCapture >> view0;
-            view0.copyTo(result);
+            // in skim mode, we only grab the frames we skip: they are not decoded
+            for( int k = 1; k < skimStride; k++ )
+                if( !inputCapture.grab() )
+                    return result;
+
+            if( inputCapture.grab() )
+                inputCapture.retrieve(frameBuffer);
+            else
+                frameBuffer.release();
+            result = frameBuffer;
         }
         else if( atImageList < (int)imageList.size() )
             result = imread(imageList[atImageList++], CV_LOAD_IMAGE_COLOR);
@@ -258,17 +313,75 @@ enum { DETECTION = 0, CAPTURING = 1, CALIBRATED = 2 };
 // - when the calibration is successful, we switch to this mode
 
 
+// incremental calibration: the calibration is solved again on a worker thread each time
+// a few frames have been captured, so the capture loop never waits for calibrateCamera
+// - each solve starts from the camera matrix and the distortion of the previous solve
+//   (CV_CALIB_USE_INTRINSIC_GUESS), so it converges in a few iterations
+// - the capture stops when the change of the camera matrix and of the reprojection error
+//   has been small during CALIB_PLATEAU_SOLVES consecutive solves
+// - the views whose reprojection error is much higher than the others are reported
+const int CALIB_MIN_VIEWS = 4;                    // no solve with less views
+const double CALIB_PARAMETER_TOLERANCE = 0.005;   // relative change of the camera matrix
+const double CALIB_ERROR_TOLERANCE = 0.02;        // relative change of the reprojection error
+const int CALIB_PLATEAU_SOLVES = 2;
+const double CALIB_OUTLIER_FACTOR = 3;            // outlier: error > factor * median error of the views
+
+class BackgroundCalibrator
+{
+public:
+    BackgroundCalibrator(Settings& s);
+    ~BackgroundCalibrator();
+    void submit(const vector<vector<Point2f> >& imagePoints, const vector<int>& imageIndices, Size imageSize);
+    void reset();
+    bool converged() const { return isConverged; }
+
+private:
+    void run();
+
+    Settings& s;                 // only the pattern and calibration settings are read by the worker
+    thread worker;               // started by the first submit
+    mutex lock;                  // protects everything below, except isConverged
+    condition_variable wakeup;
+    bool stopping;
+    bool hasPending;             // the points to solve next (only the last submitted points are kept)
+    vector<vector<Point2f> > pendingPoints;
+    vector<int> pendingIndices;  // the number of the picture of each element of pendingPoints
+    Size pendingSize;
+    int generation;              // incremented by reset, the solves of a previous generation are dropped
+    Mat cameraMatrix, distCoeffs;  // the last solution, used as the starting point of the next solve
+    double lastError;
+    int nbStableSolves;
+    atomic<bool> isConverged;
+};
+
+
 bool runCalibrationAndSave(Settings& s, Size imageSize, Mat&  cameraMatrix, Mat& distCoeffs,
                            vector<vector<Point2f> > imagePoints );
+bool estimateReprojectionError(Settings& s, Size imageSize, const vector<vector<Point2f> >& imagePoints,
+                               double& totalAvgErr);
+bool findPattern(const Settings& s, const Mat& view, vector<Point2f>& pointBuf);
+bool findPatternCached(const Settings& s, const string& filename, Mat& view, vector<Point2f>& pointBuf,
+                       Size& imageSize);
+void detectPatternsInParallel(const Settings& s, vector<vector<Point2f> >& imagePoints, Size& imageSize);
 
 
 int main(int argc, char* argv[])
 {
     help(); // display the help message
 
+    // the optional "--headless" argument can be anywhere after the program name
+    bool headless = false;
+    string inputSettingsFile = "default.xml";
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--headless"))
+            headless = true;
+        else
+            inputSettingsFile = argv[i];
+    }
+
     // we read settings (which pattern is used, ...) from an XML file
     Settings s;
-    const string inputSettingsFile = argc > 1 ? argv[1] : "default.xml";
     FileStorage fs(inputSettingsFile, FileStorage::READ); // open the file and read the settings
 
     if (!fs.isOpened())
@@ -287,17 +400,52 @@ int main(int argc, char* argv[])
     }
 
 
+    // headless mode: all the pictures are decoded and the pattern is detected in parallel,
+    // then the calibration is run once with the points of the first nrFrames pictures
+    if (headless)
+    {
+        if (s.inputType != Settings::IMAGE_LIST)
+        {
+            cout << "The headless mode needs an image list as input. Application stopping." << endl;
+            return -1;
+        }
+
+        vector<vector<Point2f> > imagePoints;
+        Mat cameraMatrix, distCoeffs;
+        Size imageSize;
+        clock_t start = clock();
+        time_t wall_start = time(NULL);
+        detectPatternsInParallel(s, imagePoints, imageSize);
+        cout << "pattern detection: " << imagePoints.size() << " pictures used, "
+             << difftime(time(NULL), wall_start) << " s ("
+             << (double)(clock() - start) / CLOCKS_PER_SEC << " s of CPU time)" << endl;
+
+        if (imagePoints.empty())
+        {
+            cout << "The pattern was not found in any picture. Application stopping." << endl;
+            return -1;
+        }
+        bool ok = runCalibrationAndSave(s, imageSize, cameraMatrix, distCoeffs, imagePoints);
+        cout << endl;
+        return ok ? 0 : -1;
+    }
+
+
     // we prepare variables for the calibration algorithm
 
     // the inner vector is the list of points detected on the pattern on a single image
     // the outer vector is the list of points for all images on which the pattern detection was successful
     vector<vector<Point2f> > imagePoints;
+    vector<int> imageIndices;  // the number of the picture of each element of imagePoints
     
     Mat cameraMatrix, distCoeffs;
     Size imageSize;  // Size object has 2 attributes: width and height
-    // CAPTURING mode for images, DETECTION mode for video
-    int mode = (s.inputType == Settings::IMAGE_LIST) ? CAPTURING : DETECTION;
+    // CAPTURING mode for images and skimmed videos, DETECTION mode for video
+    int mode = (s.inputType == Settings::IMAGE_LIST || s.skim) ? CAPTURING : DETECTION;
     clock_t prevTimestamp = 0;
+    FrameSelector selector;            // used if "Calibrate_SelectFrames" is set in the XML
+    bool selectionConverged = false;   // the selected frames are enough for the calibration
+    BackgroundCalibrator calibrator(s);  // used if "Calibrate_Incremental" is set in the XML
     const Scalar RED(0,0,255), GREEN(0,255,0);
     const char ESC_KEY = 27; // press ESCAPE to exit
 
@@ -311,8 +459,19 @@ int main(int argc, char* argv[])
         // if we have collected enough images on which the pattern detection was successful,
         // we run the calibration algorithm
         // NB: nrFrames is the number of frames to use for the calibration (given in the XML)
-        if( mode == CAPTURING && imagePoints.size() >= (unsigned)s.nrFrames )
+        // with the frame selection, the calibration is run as soon as the selection has converged
+        // in incremental mode, as soon as the background calibration has converged
+        // (and the selected frames cover enough of the picture, with the frame selection)
+        if( mode == CAPTURING && s.incremental && calibrator.converged() &&
+            (!s.selectFrames || selector.coverage() >= SELECTION_MIN_COVERAGE) )
         {
+            cout << "the background calibration has converged with " << imagePoints.size() << " frames" << endl;
+            selectionConverged = true;
+        }
+        if( mode == CAPTURING && (imagePoints.size() >= (unsigned)s.nrFrames || selectionConverged) )
+        {
+            selectionConverged = false;
+            calibrator.reset();
             // if calibration algorithm is successful, we switch to CALIBRATED mode
             if( runCalibrationAndSave(s, imageSize,  cameraMatrix, distCoeffs, imagePoints)) {
                 mode = CALIBRATED;
@@ -348,51 +507,69 @@ int main(int argc, char* argv[])
         // it will give us a list of points (inner corners positions in the case of the checkerboard)
         // which will be later used by the calibration algorithm when we will have done this
         // for enough pictures
-        bool found;
+        // with the frame selection, the blurry frames and the frames too similar to the last
+        // selected frame are not searched for the pattern while capturing
         vector<Point2f> pointBuf;
-        switch( s.calibrationPattern ) // Find feature points on the input format
+        bool selecting = (mode == CAPTURING && s.selectFrames);
+        bool scored = !selecting || selector.scoreFrame(view);
+        bool found;
+        if( !scored )
+            found = false;
+        // the pictures of a list may already be in the corner cache
+        else if( s.inputType == Settings::IMAGE_LIST && s.cornerCache )
         {
-            case Settings::CHESSBOARD:
-                found = findChessboardCorners( view, s.boardSize, pointBuf,
-                    CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK | CV_CALIB_CB_NORMALIZE_IMAGE);
-                break;
-            case Settings::CIRCLES_GRID:
-                found = findCirclesGrid( view, s.boardSize, pointBuf );
-                break;
-            case Settings::ASYMMETRIC_CIRCLES_GRID:
-                found = findCirclesGrid( view, s.boardSize, pointBuf, CALIB_CB_ASYMMETRIC_GRID );
-                break;
-            default:
-                found = false;
-                break;
+            Size cachedSize;
+            found = findPatternCached(s, s.imageList[s.atImageList - 1], view, pointBuf, cachedSize);
         }
+        else
+            found = findPattern(s, view, pointBuf);
 
         if (found)  // if we detected the pattern (chess / circle / asymetric circle)
         {
             cout << "picture " << i << ": pattern found" << endl;
+            bool captured = false;  // the points are kept for the calibration
 
-            // we try to improve the found corners' coordinate accuracy for chessboard
-            // by converting the image to gray, and by applying an algorithm which
-            // give corner positions more precise than the integer number of the pixel
-            if( s.calibrationPattern == Settings::CHESSBOARD)
+            // with the frame selection, the frame is kept only if the pattern covers new parts
+            // of the picture, and we check if the reprojection error has converged
+            if( selecting )
             {
-                Mat viewGray;
-                cvtColor(view, viewGray, COLOR_BGR2GRAY);
-                cornerSubPix( viewGray, pointBuf, Size(11,11),
-                    Size(-1,-1), TermCriteria( CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 30, 0.1 ));
+                if( selector.addCorners(pointBuf, imageSize) )
+                {
+                    imagePoints.push_back(pointBuf);
+                    imageIndices.push_back(i);
+                    captured = true;
+                    blinkOutput = s.inputCapture.isOpened();
+                    cout << "picture " << i << ": selected, coverage " << selector.coverage() << endl;
+
+                    // (in incremental mode, the background calibration checks the convergence)
+                    double totalAvgErr;
+                    if( !s.incremental && (int)imagePoints.size() >= SELECTION_MIN_FRAMES &&
+                        estimateReprojectionError(s, imageSize, imagePoints, totalAvgErr) )
+                        selectionConverged = selector.converged(totalAvgErr);
+                }
             }
-
-            if( mode == CAPTURING &&  // For camera only take new samples after delay time
-                (!s.inputCapture.isOpened() || clock() - prevTimestamp > s.delay*1e-3*CLOCKS_PER_SEC) )
+            // For camera only take new samples after delay time
+            // (in skim mode, the frames are already "delay" milliseconds of video apart)
+            else if( mode == CAPTURING &&
+                (!s.inputCapture.isOpened() || s.skim || clock() - prevTimestamp > s.delay*1e-3*CLOCKS_PER_SEC) )
             {
                 imagePoints.push_back(pointBuf);
+                imageIndices.push_back(i);
+                captured = true;
                 prevTimestamp = clock();
                 blinkOutput = s.inputCapture.isOpened();
             }
 
+            // in incremental mode, we solve again in the background every few captured frames
+            if( captured && s.incremental && imagePoints.size() % s.incrementalStep == 0 )
+                calibrator.submit(imagePoints, imageIndices, imageSize);
+
             // Draw the corners.
             drawChessboardCorners( view, s.boardSize, Mat(pointBuf), found );
         }
+        else if( !scored )
+            cout << "picture " << i << ": skipped (sharpness " << selector.last_sharpness
+                 << ", motion " << selector.last_motion << ")" << endl;
         else
             cout << "picture " << i << ": pattern not found" << endl;
 
@@ -431,7 +608,8 @@ int main(int argc, char* argv[])
 
 
         // we check for input by the user
-        char key = (char)waitKey(s.inputCapture.isOpened() ? 50 : s.delay);
+        // (in skim mode, we don't wait: the video is processed as fast as possible)
+        char key = (char)waitKey(s.skim ? 1 : s.inputCapture.isOpened() ? 50 : s.delay);
 
         // press ESCAPE to exit
         if( key  == ESC_KEY )
@@ -447,6 +625,10 @@ int main(int argc, char* argv[])
             mode = CAPTURING;
             cout << "switching to CAPTURING mode" << endl;
             imagePoints.clear();
+            imageIndices.clear();
+            selector.reset();
+            selectionConverged = false;
+            calibrator.reset();
         }
     } // end loop on the images
 
@@ -478,6 +660,199 @@ int main(int argc, char* argv[])
 
 
 
+// the parameters of the detection of findPattern
+const int CHESSBOARD_FLAGS = CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK | CV_CALIB_CB_NORMALIZE_IMAGE;
+const int SUBPIX_WINDOW = 11;
+const float SUBPIX_EPSILON = 0.1f;
+
+/**
+    Find the calibration pattern in a picture: the points given by the detection are
+    refined with cornerSubPix for the chessboard
+
+    @param s The settings (pattern and board size)
+    @param view The picture (BGR)
+    @param pointBuf The output points of the pattern
+    @return true if the pattern was found
+*/
+bool findPattern(const Settings& s, const Mat& view, vector<Point2f>& pointBuf)
+{
+    // we try to find in the pictures the calibration pattern we chose
+    // it will give us a list of points (inner corners positions in the case of the checkerboard)
+    // which will be later used by the calibration algorithm when we will have done this
+    // for enough pictures
+    bool found;
+    switch( s.calibrationPattern ) // Find feature points on the input format
+    {
+        case Settings::CHESSBOARD:
+            // the chessboard is searched on a reduced picture first (the detection on
+            // the full size GoPro pictures is the slowest step), see chessboard_detection.cpp
+            found = findChessboardCoarseToFine( view, s.boardSize, pointBuf, CHESSBOARD_FLAGS );
+            break;
+        case Settings::CIRCLES_GRID:
+            found = findCirclesGrid( view, s.boardSize, pointBuf );
+            break;
+        case Settings::ASYMMETRIC_CIRCLES_GRID:
+            found = findCirclesGrid( view, s.boardSize, pointBuf, CALIB_CB_ASYMMETRIC_GRID );
+            break;
+        default:
+            found = false;
+            break;
+    }
+
+    // we try to improve the found corners' coordinate accuracy for chessboard
+    // by converting the image to gray, and by applying an algorithm which
+    // give corner positions more precise than the integer number of the pixel
+    if( found && s.calibrationPattern == Settings::CHESSBOARD)
+    {
+        Mat viewGray;
+        cvtColor(view, viewGray, COLOR_BGR2GRAY);
+        cornerSubPix( viewGray, pointBuf, Size(SUBPIX_WINDOW,SUBPIX_WINDOW),
+            Size(-1,-1), TermCriteria( CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 30, SUBPIX_EPSILON ));
+    }
+
+    return found;
+}
+
+/**
+    Find the calibration pattern in a picture of the image list, with the corner cache:
+    if the picture was already searched with the same settings, the points are read from
+    the cache and the picture is not decoded, else the points are written to the cache
+
+    @param s The settings (pattern, board size, flip)
+    @param filename The picture filename
+    @param view The picture (flipped if needed), or an empty Mat: the picture is then decoded
+                (and flipped) only if it is not in the cache
+    @param pointBuf The output points of the pattern
+    @param imageSize The output size of the picture (empty if the picture can't be read)
+    @return true if the pattern was found
+*/
+bool findPatternCached(const Settings& s, const string& filename, Mat& view, vector<Point2f>& pointBuf,
+                       Size& imageSize)
+{
+    // everything which changes the points found in the picture is in the key of the cache
+    corner_detection_params params;
+    params.pattern = s.calibrationPattern;
+    params.board_size = s.boardSize;
+    params.flags = (s.calibrationPattern == Settings::CHESSBOARD) ? CHESSBOARD_FLAGS : 0;
+    params.refine_window = (s.calibrationPattern == Settings::CHESSBOARD) ? SUBPIX_WINDOW : 0;
+    params.refine_epsilon = (s.calibrationPattern == Settings::CHESSBOARD) ? SUBPIX_EPSILON : 0;
+    params.flip = s.flipVertical;
+
+    corner_cache_entry entry;
+    uint64 key;
+    bool hasKey = cornerCacheKeyFromFile(filename, params, key);
+    if( hasKey && loadCachedCorners(key, params, entry) )
+    {
+        imageSize = entry.image_size;
+        pointBuf = entry.corners;
+        return entry.found;
+    }
+
+    if( view.empty() )
+    {
+        view = imread(filename, CV_LOAD_IMAGE_COLOR);
+        if( view.empty() )
+        {
+            imageSize = Size();
+            return false;
+        }
+        if( s.flipVertical )
+            flip( view, view, 0 );
+    }
+
+    entry.image_size = imageSize = view.size();
+    entry.found = findPattern(s, view, entry.corners);
+    if( hasKey && !saveCachedCorners(key, params, entry) )
+        cerr << "can not write the corner cache entry of " << filename << endl;
+
+    pointBuf = entry.corners;
+    return entry.found;
+}
+
+// the result of the pattern detection on one picture of the list
+struct PatternResult
+{
+    bool found;
+    Size imageSize;
+    vector<Point2f> pointBuf;
+};
+
+// a worker of the pool: it takes the next picture of the list until there is no more picture
+static void patternWorker(const Settings& s, atomic<int>& nextImage, vector<PatternResult>& results)
+{
+    while (true)
+    {
+        int i = nextImage++;
+        if (i >= (int)s.imageList.size())
+            break;
+
+        PatternResult& result = results[i];
+        result.found = false;
+
+        // with the corner cache, the pictures already searched are not decoded
+        if( s.cornerCache )
+        {
+            Mat view;
+            result.found = findPatternCached(s, s.imageList[i], view, result.pointBuf, result.imageSize);
+            continue;
+        }
+
+        Mat view = imread(s.imageList[i], CV_LOAD_IMAGE_COLOR);
+        if (view.empty())
+            continue;
+
+        result.imageSize = view.size();
+        if( s.flipVertical )
+            flip( view, view, 0 );
+        result.found = findPattern(s, view, result.pointBuf);
+    }
+}
+
+/**
+    Decode the pictures of the image list and find the pattern on a pool of threads
+    (one per core). Each worker takes the next picture with an atomic index, and writes
+    its result at the index of the picture, so the points are kept in the order of the list
+
+    @param s The settings (image list, pattern, number of frames)
+    @param imagePoints The output points of the first nrFrames pictures where the pattern was found
+    @param imageSize The output size of the pictures
+*/
+void detectPatternsInParallel(const Settings& s, vector<vector<Point2f> >& imagePoints, Size& imageSize)
+{
+    vector<PatternResult> results(s.imageList.size());
+    atomic<int> nextImage(0);
+
+    int nbThreads = (int)thread::hardware_concurrency();
+    if (nbThreads < 1)
+        nbThreads = 1;
+    vector<thread> workers;
+    for (int t = 0; t < nbThreads; t++)
+        workers.push_back(thread(patternWorker, cref(s), ref(nextImage), ref(results)));
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+
+    // same pictures as the interactive mode: the first ones of the list, in the order of the list
+    imagePoints.clear();
+    for (size_t i = 0; i < results.size() && imagePoints.size() < (unsigned)s.nrFrames; i++)
+    {
+        if (!results[i].found)
+        {
+            cout << "picture " << i << ": pattern not found" << endl;
+            continue;
+        }
+        if (imagePoints.empty())
+            imageSize = results[i].imageSize;
+        else if (results[i].imageSize != imageSize)
+        {
+            cout << "picture " << i << ": not the same size as the first picture, ignored" << endl;
+            continue;
+        }
+        cout << "picture " << i << ": pattern found" << endl;
+        imagePoints.push_back(results[i].pointBuf);
+    }
+}
+
+
 static double computeReprojectionErrors( const vector<vector<Point3f> >& objectPoints,
                                          const vector<vector<Point2f> >& imagePoints,
                                          const vector<Mat>& rvecs, const vector<Mat>& tvecs,
@@ -529,16 +904,24 @@ static void calcBoardCornerPositions(Size boardSize, float squareSize, vector<Po
 }
 
 // return value: if the calibration was successful or not
+// with useIntrinsicGuess, cameraMatrix and distCoeffs are the starting point of the calibration
+// the messages are written to 'out' (the report of the background calibration)
 static bool runCalibration( Settings& s, Size& imageSize, Mat& cameraMatrix, Mat& distCoeffs,
                             vector<vector<Point2f> > imagePoints, vector<Mat>& rvecs, vector<Mat>& tvecs,
-                            vector<float>& reprojErrs,  double& totalAvgErr)
+                            vector<float>& reprojErrs,  double& totalAvgErr, bool useIntrinsicGuess = false,
+                            ostream& out = cout)
 {
+    int flag = s.flag|CV_CALIB_FIX_K4|CV_CALIB_FIX_K5;
+    if( useIntrinsicGuess )
+        flag |= CV_CALIB_USE_INTRINSIC_GUESS;
+    else
+    {
+        cameraMatrix = Mat::eye(3, 3, CV_64F);
+        if( s.flag & CV_CALIB_FIX_ASPECT_RATIO )
+            cameraMatrix.at<double>(0,0) = 1.0;
 
-    cameraMatrix = Mat::eye(3, 3, CV_64F);
-    if( s.flag & CV_CALIB_FIX_ASPECT_RATIO )
-        cameraMatrix.at<double>(0,0) = 1.0;
-
-    distCoeffs = Mat::zeros(8, 1, CV_64F);
+        distCoeffs = Mat::zeros(8, 1, CV_64F);
+    }
 
     vector<vector<Point3f> > objectPoints(1);
     calcBoardCornerPositions(s.boardSize, s.squareSize, objectPoints[0], s.calibrationPattern);
@@ -547,9 +930,9 @@ static bool runCalibration( Settings& s, Size& imageSize, Mat& cameraMatrix, Mat
 
     //Find intrinsic and extrinsic camera parameters
     double rms = calibrateCamera(objectPoints, imagePoints, imageSize, cameraMatrix,
-                                 distCoeffs, rvecs, tvecs, s.flag|CV_CALIB_FIX_K4|CV_CALIB_FIX_K5);
+                                 distCoeffs, rvecs, tvecs, flag);
 
-    cout << "Re-projection error reported by calibrateCamera: "<< rms << endl;
+    out << "Re-projection error reported by calibrateCamera: "<< rms << endl;
 
     bool ok = checkRange(cameraMatrix) && checkRange(distCoeffs);
 
@@ -638,6 +1021,18 @@ static void saveCameraParams( Settings& s, Size& imageSize, Mat& cameraMatrix, M
     }
 }
 
+// we run the calibration without saving it, to follow the reprojection error during the frame selection
+// return value: if the calibration was successful or not
+bool estimateReprojectionError(Settings& s, Size imageSize, const vector<vector<Point2f> >& imagePoints,
+                               double& totalAvgErr)
+{
+    Mat cameraMatrix, distCoeffs;
+    vector<Mat> rvecs, tvecs;
+    vector<float> reprojErrs;
+    return runCalibration(s, imageSize, cameraMatrix, distCoeffs, imagePoints, rvecs, tvecs,
+                          reprojErrs, totalAvgErr);
+}
+
 // return value: if the calibration was successful or not
 bool runCalibrationAndSave(Settings& s, Size imageSize, Mat& cameraMatrix, Mat& distCoeffs, 
                            vector<vector<Point2f> > imagePoints )
@@ -656,3 +1051,144 @@ bool runCalibrationAndSave(Settings& s, Size imageSize, Mat& cameraMatrix, Mat&
                             imagePoints, totalAvgErr);
     return ok;
 }
+
+
+BackgroundCalibrator::BackgroundCalibrator(Settings& s)
+    : s(s), stopping(false), hasPending(false), generation(0),
+      lastError(-1), nbStableSolves(0), isConverged(false)
+{
+}
+
+BackgroundCalibrator::~BackgroundCalibrator()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wakeup.notify_one();
+    if( worker.joinable() )
+        worker.join();
+}
+
+/**
+    Ask for a new solve with the captured points, without waiting: if a solve is running,
+    the points are solved after it (if points were already waiting, they are replaced)
+
+    @param imagePoints The points of all the captured frames
+    @param imageIndices The number of the picture of each frame, for the report of the outliers
+    @param imageSize The size of the pictures
+*/
+void BackgroundCalibrator::submit(const vector<vector<Point2f> >& imagePoints, const vector<int>& imageIndices,
+                                  Size imageSize)
+{
+    if( (int)imagePoints.size() < CALIB_MIN_VIEWS )
+        return;
+    // the worker thread is started only when the incremental calibration is used
+    if( !worker.joinable() )
+        worker = thread(&BackgroundCalibrator::run, this);
+    {
+        lock_guard<mutex> guard(lock);
+        pendingPoints = imagePoints;
+        pendingIndices = imageIndices;
+        pendingSize = imageSize;
+        hasPending = true;
+    }
+    wakeup.notify_one();
+}
+
+/**
+    Forget the previous solutions (when the capture is started again)
+*/
+void BackgroundCalibrator::reset()
+{
+    lock_guard<mutex> guard(lock);
+    generation++;
+    hasPending = false;
+    cameraMatrix.release();
+    distCoeffs.release();
+    lastError = -1;
+    nbStableSolves = 0;
+    isConverged = false;
+}
+
+// the worker thread: it solves the last submitted points, starting from the previous solution
+void BackgroundCalibrator::run()
+{
+    unique_lock<mutex> guard(lock);
+    while( true )
+    {
+        while( !stopping && !hasPending )
+            wakeup.wait(guard);
+        if( stopping )
+            return;
+
+        vector<vector<Point2f> > imagePoints;
+        vector<int> imageIndices;
+        imagePoints.swap(pendingPoints);
+        imageIndices.swap(pendingIndices);
+        hasPending = false;
+        Size imageSize = pendingSize;
+        int solveGeneration = generation;
+        Mat newCameraMatrix = cameraMatrix.clone(), newDistCoeffs = distCoeffs.clone();
+        bool warmStart = !newCameraMatrix.empty();
+        guard.unlock();
+
+        // the report is written at once, so it's not mixed with the messages of the capture loop
+        ostringstream report;
+
+        // the solve runs without the lock, so submit never waits
+        vector<Mat> rvecs, tvecs;
+        vector<float> reprojErrs;
+        double totalAvgErr = 0;
+        bool ok = runCalibration(s, imageSize, newCameraMatrix, newDistCoeffs, imagePoints, rvecs, tvecs,
+                                 reprojErrs, totalAvgErr, warmStart, report);
+
+        if( ok )
+        {
+            vector<float> sortedErrs(reprojErrs);
+            sort(sortedErrs.begin(), sortedErrs.end());
+            float medianErr = sortedErrs[sortedErrs.size() / 2];
+            report << "background calibration with " << imagePoints.size() << " frames: "
+                   << "avg re projection error = " << totalAvgErr << endl;
+            // the frames are reported with the number of their picture ("picture N" in the messages
+            // of the capture loop), and their filename for an image list
+            for( size_t i = 0; i < reprojErrs.size(); i++ )
+                if( reprojErrs[i] > CALIB_OUTLIER_FACTOR * medianErr )
+                {
+                    report << "    picture " << imageIndices[i];
+                    if( s.inputType == Settings::IMAGE_LIST && imageIndices[i] < (int)s.imageList.size() )
+                        report << " (" << s.imageList[imageIndices[i]] << ")";
+                    report << ": re projection error = " << reprojErrs[i]
+                           << " (median " << medianErr << "), probably an outlier" << endl;
+                }
+        }
+        else
+            report << "background calibration with " << imagePoints.size() << " frames failed" << endl;
+
+        guard.lock();
+        if( solveGeneration != generation || !ok )
+        {
+            cout << report.str();
+            continue;
+        }
+
+        // the change of the camera matrix (relative to the previous solution) and of the error
+        if( warmStart && lastError > 0 )
+        {
+            double parameterChange = norm(newCameraMatrix, cameraMatrix) / norm(cameraMatrix);
+            double errorChange = fabs(totalAvgErr - lastError) / lastError;
+            report << "    change of the camera matrix " << parameterChange
+                   << ", change of the error " << errorChange << endl;
+            if( parameterChange < CALIB_PARAMETER_TOLERANCE && errorChange < CALIB_ERROR_TOLERANCE )
+                nbStableSolves++;
+            else
+                nbStableSolves = 0;
+        }
+        cameraMatrix = newCameraMatrix;
+        distCoeffs = newDistCoeffs;
+        lastError = totalAvgErr;
+        if( nbStableSolves >= CALIB_PLATEAU_SOLVES )
+            isConverged = true;
+        cout << report.str();
+    }
+}
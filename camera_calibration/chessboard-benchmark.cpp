@@ -0,0 +1,110 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <iostream>
+#include <stdlib.h>
+
+#include "chessboard_detection.h"
+
+using namespace cv;
+using namespace std;
+
+// the flags and the refinement of camera-calibration.cpp
+const int CHESSBOARD_FLAGS = CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK | CV_CALIB_CB_NORMALIZE_IMAGE;
+const int SUBPIX_WINDOW = 11;
+
+
+static void help()
+{
+    cout << "This program compares the chessboard detection on the full size pictures\n"
+            "with the detection on reduced pictures refined at full size (chessboard_detection.cpp).\n"
+            "Usage:  ./chessboard-benchmark <board_width> <board_height> <image_name(s)>\n"
+            "The board size is the number of inner corners, like in camera-calibration.xml" << endl;
+}
+
+// returns the elapsed time in milliseconds since 'start' (given by getTickCount)
+static double elapsedMs(int64 start) {
+    return (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
+
+// the refinement of the corners, like in camera-calibration.cpp: done once for both
+// detections, findChessboardCoarseToFine gives corners which are not refined
+static void refineCorners(const Mat& gray, vector<Point2f>& corners) {
+    cornerSubPix(gray, corners, Size(SUBPIX_WINDOW, SUBPIX_WINDOW), Size(-1,-1),
+                 TermCriteria(CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 30, 0.1));
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 4) {
+        help();
+        return -1;
+    }
+    Size board_size(atoi(argv[1]), atoi(argv[2]));
+
+    double time_full_total = 0, time_coarse_total = 0;
+    double error_max = 0, error_sum = 0;
+    int nb_corners = 0, nb_found_full = 0, nb_found_coarse = 0;
+
+    for (int i = 3; i < argc; i++) {
+        Mat image = imread(argv[i], CV_LOAD_IMAGE_COLOR);
+        if (image.empty()) {
+            cout << "can not open " << argv[i] << endl;
+            continue;
+        }
+        Mat gray;
+        cvtColor(image, gray, COLOR_BGR2GRAY);
+
+        // detection on the full size picture
+        vector<Point2f> corners_full;
+        int64 start = getTickCount();
+        bool found_full = findChessboardCorners(gray, board_size, corners_full, CHESSBOARD_FLAGS);
+        if (found_full)
+            refineCorners(gray, corners_full);
+        double time_full = elapsedMs(start);
+
+        // detection on the reduced picture, refined on the full size picture
+        vector<Point2f> corners_coarse;
+        start = getTickCount();
+        bool found_coarse = findChessboardCoarseToFine(gray, board_size, corners_coarse, CHESSBOARD_FLAGS);
+        if (found_coarse)
+            refineCorners(gray, corners_coarse);
+        double time_coarse = elapsedMs(start);
+
+        time_full_total += time_full;
+        time_coarse_total += time_coarse;
+        nb_found_full += found_full;
+        nb_found_coarse += found_coarse;
+
+        cout << argv[i] << " (" << image.cols << "x" << image.rows << "): full size "
+             << time_full << " ms" << (found_full ? "" : " (not found)") << ", coarse to fine "
+             << time_coarse << " ms" << (found_coarse ? "" : " (not found)");
+
+        // the corners are given in the same order by both detections
+        if (found_full && found_coarse) {
+            double image_error_max = 0;
+            for (size_t j = 0; j < corners_full.size(); j++) {
+                double error = norm(corners_full[j] - corners_coarse[j]);
+                image_error_max = MAX(image_error_max, error);
+                error_sum += error;
+            }
+            nb_corners += (int)corners_full.size();
+            error_max = MAX(error_max, image_error_max);
+            cout << ", maximum difference " << image_error_max << " px";
+        }
+        cout << endl;
+    }
+
+    cout << endl << "chessboard found in " << nb_found_full << " pictures at full size, "
+         << nb_found_coarse << " pictures coarse to fine" << endl;
+    if (time_coarse_total > 0)
+        cout << "total time: full size " << time_full_total << " ms, coarse to fine "
+             << time_coarse_total << " ms, speedup " << time_full_total / time_coarse_total << "x" << endl;
+    if (nb_corners > 0)
+        cout << "difference of the corners: mean " << error_sum / nb_corners
+             << " px, maximum " << error_max << " px" << endl;
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+#include "chessboard_detection.h"
+
+using namespace cv;
+using namespace std;
+
+
+/**
+    Find the chessboard corners like findChessboardCorners, but on a reduced picture first:
+    the corners found on the reduced picture are scaled back to the full size picture.
+    Like with findChessboardCorners, the corners are not refined: the caller refines them
+    with cornerSubPix on the full size picture (its window must be larger than the
+    scale factor, a window of 11 is enough up to 4K pictures). If the chessboard is not
+    found on the reduced picture, it is searched on the full size picture
+
+    @param image The picture (BGR or grayscale)
+    @param boardSize The number of inner corners of the chessboard (width and height)
+    @param corners The output corners
+    @param flags The flags of findChessboardCorners
+    @return true if the chessboard was found
+*/
+bool findChessboardCoarseToFine(const Mat& image, Size boardSize, vector<Point2f>& corners, int flags) {
+    int longest_side = MAX(image.cols, image.rows);
+    if (longest_side <= CHESSBOARD_COARSE_SIZE)
+        return findChessboardCorners(image, boardSize, corners, flags);
+
+    Mat gray;
+    if (image.channels() == 3)
+        cvtColor(image, gray, COLOR_BGR2GRAY);
+    else
+        gray = image;
+
+    // INTER_AREA averages the pixels, so the reduced picture has no aliasing on the squares
+    double scale = (double)CHESSBOARD_COARSE_SIZE / longest_side;
+    Mat reduced;
+    resize(gray, reduced, Size(), scale, scale, INTER_AREA);
+
+    if (findChessboardCorners(reduced, boardSize, corners, flags)) {
+        // the center of a pixel of the reduced picture is at (x + 0.5) / scale - 0.5
+        // in the full size picture
+        for (size_t i = 0; i < corners.size(); i++) {
+            corners[i].x = (float)((corners[i].x + 0.5) / scale - 0.5);
+            corners[i].y = (float)((corners[i].y + 0.5) / scale - 0.5);
+        }
+        return true;
+    }
+
+    // the chessboard may be too small on the reduced picture
+    return findChessboardCorners(gray, boardSize, corners, flags);
+}
@@ -0,0 +1,20 @@
+#ifndef CHESSBOARD_DETECTION_H
+#define CHESSBOARD_DETECTION_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+// the chessboard is first searched on the picture reduced to this size (longest side, pixels):
+// the detection is much slower than the refinement of the corners on big pictures
+const int CHESSBOARD_COARSE_SIZE = 1280;
+
+
+bool findChessboardCoarseToFine(const Mat& image, Size boardSize, vector<Point2f>& corners, int flags);
+
+
+#endif
@@ -0,0 +1,202 @@
+#include "corner_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+
+using namespace cv;
+using namespace std;
+
+
+// FNV-1a hash (64 bits)
+const uint64 FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64 FNV_PRIME = 1099511628211ULL;
+
+// the header of a cache file, followed by the x and y of the corners (floats)
+typedef struct {
+    char magic[4];           // "CRNR"
+    int version;             // CORNER_CACHE_VERSION
+    uint64 key;
+    int pattern;
+    int board_width;
+    int board_height;
+    int flags;
+    int refine_window;
+    float refine_epsilon;
+    int flip;
+    int image_width;
+    int image_height;
+    int found;
+    int nb_corners;
+} corner_cache_header;
+
+static const char CORNER_CACHE_MAGIC[4] = {'C', 'R', 'N', 'R'};
+
+
+// we add bytes to a FNV-1a hash
+static void hashBytes(uint64& hash, const void* data, size_t size) {
+    const uchar* bytes = (const uchar*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+}
+
+// we add the detection parameters to the hash of the picture (one field at a time,
+// the padding of the structure is not hashed)
+static void hashParams(uint64& hash, const corner_detection_params& params) {
+    int version = CORNER_CACHE_VERSION;
+    hashBytes(hash, &version, sizeof(version));
+    hashBytes(hash, &params.pattern, sizeof(params.pattern));
+    hashBytes(hash, &params.board_size.width, sizeof(params.board_size.width));
+    hashBytes(hash, &params.board_size.height, sizeof(params.board_size.height));
+    hashBytes(hash, &params.flags, sizeof(params.flags));
+    hashBytes(hash, &params.refine_window, sizeof(params.refine_window));
+    hashBytes(hash, &params.refine_epsilon, sizeof(params.refine_epsilon));
+    hashBytes(hash, &params.flip, sizeof(params.flip));
+}
+
+// the filename of the cache entry of a key: 16 hexadecimal digits
+static string cacheFilename(uint64 key) {
+    char name[32];
+    sprintf(name, "%016llx.bin", (unsigned long long)key);
+    return CORNER_CACHE_DIRECTORY + "/" + name;
+}
+
+/**
+    Compute the key of a picture file: the hash of the bytes of the file (the picture is not
+    decoded, so a cached picture can be skipped without decoding it) and of the parameters
+
+    @param filename The picture filename
+    @param params The detection parameters
+    @param key The output key
+    @return false if the file can't be read
+*/
+bool cornerCacheKeyFromFile(const string& filename, const corner_detection_params& params, uint64& key) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == NULL)
+        return false;
+
+    uint64 hash = FNV_OFFSET_BASIS;
+    vector<uchar> buffer(1 << 16);
+    size_t size;
+    while ((size = fread(&buffer[0], 1, buffer.size(), file)) > 0)
+        hashBytes(hash, &buffer[0], size);
+    fclose(file);
+
+    hashParams(hash, params);
+    key = hash;
+    return true;
+}
+
+/**
+    Compute the key of a decoded picture: the hash of its size, type and pixels, and of the parameters
+    (for the pictures which are not read from a file, like the webcam pictures)
+
+    @param image The picture
+    @param params The detection parameters
+    @return The key
+*/
+uint64 cornerCacheKey(const Mat& image, const corner_detection_params& params) {
+    uint64 hash = FNV_OFFSET_BASIS;
+    int description[3] = { image.cols, image.rows, image.type() };
+    hashBytes(hash, description, sizeof(description));
+    for (int y = 0; y < image.rows; y++)
+        hashBytes(hash, image.ptr(y), image.cols * image.elemSize());
+
+    hashParams(hash, params);
+    return hash;
+}
+
+/**
+    Read the result of the detection in a picture from the cache
+
+    @param key The key of the picture (cornerCacheKey or cornerCacheKeyFromFile)
+    @param params The detection parameters, checked against the ones written in the entry
+    @param entry The output result
+    @return false if the picture is not in the cache, or if the entry is invalid
+*/
+bool loadCachedCorners(uint64 key, const corner_detection_params& params, corner_cache_entry& entry) {
+    FILE* file = fopen(cacheFilename(key).c_str(), "rb");
+    if (file == NULL)
+        return false;
+
+    corner_cache_header header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+        && memcmp(header.magic, CORNER_CACHE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == CORNER_CACHE_VERSION
+        && header.key == key
+        && header.pattern == params.pattern
+        && header.board_width == params.board_size.width
+        && header.board_height == params.board_size.height
+        && header.flags == params.flags
+        && header.refine_window == params.refine_window
+        && header.refine_epsilon == params.refine_epsilon
+        && header.flip == params.flip
+        && header.nb_corners >= 0;
+
+    if (ok) {
+        entry.found = header.found != 0;
+        entry.image_size = Size(header.image_width, header.image_height);
+        entry.corners.resize(header.nb_corners);
+        if (header.nb_corners > 0)
+            ok = fread(&entry.corners[0], sizeof(Point2f), header.nb_corners, file) == (size_t)header.nb_corners;
+    }
+    fclose(file);
+    return ok;
+}
+
+/**
+    Write the result of the detection in a picture to the cache. The entry is written to
+    a temporary file which is then renamed, so a partly written entry is never read
+    (the name of the temporary file has the process id, so several programs can write
+    in the same cache at the same time)
+
+    @param key The key of the picture (cornerCacheKey or cornerCacheKeyFromFile)
+    @param params The detection parameters
+    @param entry The result
+    @return false if the entry could not be written
+*/
+bool saveCachedCorners(uint64 key, const corner_detection_params& params, const corner_cache_entry& entry) {
+    static atomic<int> nb_temporary_files(0);
+
+    mkdir(CORNER_CACHE_DIRECTORY.c_str(), 0755);  // fails if it already exists
+    string filename = cacheFilename(key);
+    char suffix[32];
+    sprintf(suffix, ".tmp%d-%d", (int)getpid(), nb_temporary_files++);
+    string temporary_filename = filename + suffix;
+
+    FILE* file = fopen(temporary_filename.c_str(), "wb");
+    if (file == NULL)
+        return false;
+
+    corner_cache_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CORNER_CACHE_MAGIC, sizeof(header.magic));
+    header.version = CORNER_CACHE_VERSION;
+    header.key = key;
+    header.pattern = params.pattern;
+    header.board_width = params.board_size.width;
+    header.board_height = params.board_size.height;
+    header.flags = params.flags;
+    header.refine_window = params.refine_window;
+    header.refine_epsilon = params.refine_epsilon;
+    header.flip = params.flip;
+    header.image_width = entry.image_size.width;
+    header.image_height = entry.image_size.height;
+    header.found = entry.found;
+    header.nb_corners = (int)entry.corners.size();
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (ok && !entry.corners.empty())
+        ok = fwrite(&entry.corners[0], sizeof(Point2f), entry.corners.size(), file) == entry.corners.size();
+    ok = (fclose(file) == 0) && ok;
+
+    if (ok)
+        ok = rename(temporary_filename.c_str(), filename.c_str()) == 0;
+    if (!ok)
+        remove(temporary_filename.c_str());
+    return ok;
+}
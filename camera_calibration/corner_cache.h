@@ -0,0 +1,49 @@
+#ifndef CORNER_CACHE_H
+#define CORNER_CACHE_H
+
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+// the directory of the cache (created if needed), in the current directory
+const string CORNER_CACHE_DIRECTORY = ".corner-cache";
+
+// the version of the file format and of the detection: to change when the detection
+// code changes, so the entries written by the previous version are not used any more
+const int CORNER_CACHE_VERSION = 2;
+
+// the number of the chessboard pattern in corner_detection_params (Settings::CHESSBOARD
+// in camera-calibration.cpp), for the programs which use only the chessboard
+const int CORNER_CACHE_PATTERN_CHESSBOARD = 1;
+
+
+// everything that changes the points found in a picture: the cache entries are stored
+// under a key computed from the picture and these parameters, so an entry is not used
+// any more when one of them changes
+typedef struct {
+    int pattern;            // the calibration pattern, as numbered by the program
+    Size board_size;        // number of inner corners (width and height)
+    int flags;              // flags of the detection
+    int refine_window;      // half size of the cornerSubPix window (0 without refinement)
+    float refine_epsilon;   // epsilon of the termination criteria of cornerSubPix
+    int flip;               // non zero if the picture is flipped before the detection
+} corner_detection_params;
+
+// the result of the detection in a picture
+typedef struct {
+    bool found;              // false if the pattern was not found (the failures are cached too)
+    Size image_size;         // the size of the picture, so it doesn't need to be decoded
+    vector<Point2f> corners;
+} corner_cache_entry;
+
+
+bool cornerCacheKeyFromFile(const string& filename, const corner_detection_params& params, uint64& key);
+uint64 cornerCacheKey(const Mat& image, const corner_detection_params& params);
+bool loadCachedCorners(uint64 key, const corner_detection_params& params, corner_cache_entry& entry);
+bool saveCachedCorners(uint64 key, const corner_detection_params& params, const corner_cache_entry& entry);
+
+
+#endif
@@ -0,0 +1,130 @@
+#include "frame_selection.h"
+
+#include <math.h>
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+
+FrameSelector::FrameSelector() {
+    reset();
+}
+
+/**
+    Forget all the selected frames (when the capture is started again)
+*/
+void FrameSelector::reset() {
+    nb_selected = 0;
+    last_sharpness = 0;
+    last_motion = 0;
+    candidate.release();
+    selected.release();
+    sharpness_history.clear();
+    sharpness_index = 0;
+    covered.assign(SELECTION_GRID_COLS * SELECTION_GRID_ROWS, 0);
+    nb_covered = 0;
+    last_error = -1;
+}
+
+/**
+    Score a frame before the pattern detection: the sharpness is the variance of the Laplacian
+    (compared with the median of the recent frames), and the motion is the mean absolute
+    difference with the last selected frame, both computed on a reduced gray picture
+
+    @param view The frame (BGR)
+    @return true if the frame is sharp and different enough from the last selected frame
+            to be searched for the pattern
+*/
+bool FrameSelector::scoreFrame(const Mat& view) {
+    Mat gray;
+    cvtColor(view, gray, COLOR_BGR2GRAY);
+    if (gray.cols > SELECTION_SCORE_WIDTH) {
+        double scale = (double)SELECTION_SCORE_WIDTH / gray.cols;
+        resize(gray, candidate, Size(), scale, scale, INTER_AREA);
+    }
+    else
+        candidate = gray;
+
+    Mat laplacian;
+    Scalar average, stddev;
+    Laplacian(candidate, laplacian, CV_16S);
+    meanStdDev(laplacian, average, stddev);
+    last_sharpness = stddev[0] * stddev[0];
+
+    // the median of the recent frames, so that a single very textured frame doesn't make
+    // all the next ones look blurry
+    if ((int)sharpness_history.size() < SELECTION_SHARPNESS_HISTORY)
+        sharpness_history.push_back(last_sharpness);
+    else
+        sharpness_history[sharpness_index] = last_sharpness;
+    sharpness_index = (sharpness_index + 1) % SELECTION_SHARPNESS_HISTORY;
+    vector<double> recent(sharpness_history);
+    nth_element(recent.begin(), recent.begin() + recent.size() / 2, recent.end());
+    double median_sharpness = recent[recent.size() / 2];
+
+    // the first frame, or a frame of another size, is always different
+    if (selected.empty() || selected.size() != candidate.size())
+        last_motion = 255;
+    else {
+        Mat difference;
+        absdiff(candidate, selected, difference);
+        last_motion = mean(difference)[0];
+    }
+
+    return last_sharpness >= SELECTION_MIN_SHARPNESS_RATIO * median_sharpness
+        && last_motion >= SELECTION_MIN_MOTION;
+}
+
+/**
+    Decide if the pattern found in the last scored frame is kept for the calibration:
+    it must cover cells of the grid that no selected frame covered
+
+    @param corners The points of the pattern found in the frame
+    @param image_size The size of the frame
+    @return true if the frame is selected
+*/
+bool FrameSelector::addCorners(const vector<Point2f>& corners, Size image_size) {
+    vector<uchar> cells(covered.size(), 0);
+    for (size_t i = 0; i < corners.size(); i++) {
+        int col = (int)(corners[i].x * SELECTION_GRID_COLS / image_size.width);
+        int row = (int)(corners[i].y * SELECTION_GRID_ROWS / image_size.height);
+        if (col >= 0 && col < SELECTION_GRID_COLS && row >= 0 && row < SELECTION_GRID_ROWS)
+            cells[row * SELECTION_GRID_COLS + col] = 1;
+    }
+
+    int nb_new_cells = 0;
+    for (size_t i = 0; i < cells.size(); i++)
+        if (cells[i] && !covered[i])
+            nb_new_cells++;
+    if (nb_new_cells < SELECTION_MIN_NEW_CELLS)
+        return false;
+
+    for (size_t i = 0; i < cells.size(); i++)
+        covered[i] |= cells[i];
+    nb_covered += nb_new_cells;
+    nb_selected++;
+    candidate.copyTo(selected);
+    return true;
+}
+
+/**
+    Check if the selection can stop, after a calibration with the selected frames
+
+    @param reprojection_error The reprojection error of the calibration with the selected frames
+    @return true if enough frames are selected, the grid is covered enough, and the reprojection
+            error has almost not changed since the previous selected frame
+*/
+bool FrameSelector::converged(double reprojection_error) {
+    bool stable = last_error > 0
+        && fabs(reprojection_error - last_error) < SELECTION_ERROR_TOLERANCE * last_error;
+    last_error = reprojection_error;
+    return stable && nb_selected >= SELECTION_MIN_FRAMES && coverage() >= SELECTION_MIN_COVERAGE;
+}
+
+/**
+    @return The ratio of the cells of the grid covered by the selected frames
+*/
+double FrameSelector::coverage() const {
+    return (double)nb_covered / covered.size();
+}
@@ -0,0 +1,66 @@
+#ifndef FRAME_SELECTION_H
+#define FRAME_SELECTION_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+// the frames are scored before the pattern detection on a picture reduced to this width (pixels)
+const int SELECTION_SCORE_WIDTH = 960;
+
+// a frame is blurry when the variance of its Laplacian is less than this ratio of the median
+// variance of the last SELECTION_SHARPNESS_HISTORY scored frames (the absolute value depends
+// on the camera and the scene: a board close to the camera gives a much higher variance
+// than a far one, so we compare only with the recent frames)
+const double SELECTION_MIN_SHARPNESS_RATIO = 0.5;
+const int SELECTION_SHARPNESS_HISTORY = 30;
+
+// a frame is redundant when the mean absolute difference (gray levels) with the last selected
+// frame is less than this: the board and the camera have almost not moved
+const double SELECTION_MIN_MOTION = 4;
+
+// the picture is divided in a grid, and a frame is selected only if the pattern covers
+// at least SELECTION_MIN_NEW_CELLS cells that no selected frame covered
+const int SELECTION_GRID_COLS = 8;
+const int SELECTION_GRID_ROWS = 6;
+const int SELECTION_MIN_NEW_CELLS = 2;
+
+// the selection stops when at least SELECTION_MIN_FRAMES frames are selected, at least
+// SELECTION_MIN_COVERAGE of the cells are covered, and the relative change of the
+// reprojection error after the last selected frame is less than SELECTION_ERROR_TOLERANCE
+const int SELECTION_MIN_FRAMES = 8;
+const double SELECTION_MIN_COVERAGE = 0.7;
+const double SELECTION_ERROR_TOLERANCE = 0.05;
+
+
+// selects the frames used for the calibration: the sharp frames where the view has changed
+// are searched for the pattern, and only the ones where the pattern covers new parts of
+// the picture are kept, until the coverage and the reprojection error converge
+class FrameSelector {
+public:
+    FrameSelector();
+    void reset();
+    bool scoreFrame(const Mat& view);
+    bool addCorners(const vector<Point2f>& corners, Size image_size);
+    bool converged(double reprojection_error);
+    double coverage() const;
+
+    int nb_selected;         // number of selected frames
+    double last_sharpness;   // variance of the Laplacian of the last scored frame
+    double last_motion;      // mean absolute difference of the last scored frame with the last selected frame
+
+private:
+    Mat candidate;           // reduced gray picture of the last scored frame
+    Mat selected;            // reduced gray picture of the last selected frame
+    vector<double> sharpness_history;  // variance of the Laplacian of the last scored frames
+    int sharpness_index;     // where the next variance is written in sharpness_history
+    vector<uchar> covered;   // the cells of the grid covered by the selected frames
+    int nb_covered;
+    double last_error;       // reprojection error after the previous selected frame (negative if none)
+};
+
+
+#endif
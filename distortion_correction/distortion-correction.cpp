@@ -1,11 +1,17 @@
-// g++ distortion-correction.cpp -o distortion-correction `pkg-config --cflags --libs opencv`
+// g++ -std=c++11 distortion-correction.cpp undistortion.cpp transcoder.cpp -o distortion-correction `pkg-config --cflags --libs opencv` -pthread
+// ./distortion-correction [video filename] [calibration filename] [x y width height] [--output file.avi] [--chunks N]
 
 #include <iostream>
+#include <chrono>
+#include <thread>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/calib3d/calib3d.hpp>
 
+#include "undistortion.h"
+#include "transcoder.h"
+
 using namespace cv;
 using namespace std;
 
@@ -19,6 +25,36 @@ int main(int argc, char** argv) {
     const string video_filename       = argv[1];
     const string calibration_filename = argv[2];
 
+    // optionally, a region of interest of the undistorted frame can be given
+    // (for example the bounding box of the table printed by the hough-transform program),
+    // then only this region is undistorted
+    Rect roi;
+    // if an output filename is given, the undistorted video is written to this file
+    // (in several chunks in parallel) instead of being displayed
+    string output_filename;
+    int nb_chunks = max(1, (int)thread::hardware_concurrency() / 2);
+
+    vector<int> roi_values;
+    for (int i = 3; i < argc; i++) {
+        if ((string(argv[i]) == "--output" || string(argv[i]) == "--chunks") && i+1 == argc) {
+            cerr << "Missing value after " << argv[i] << endl;
+            exit(1);
+        }
+        if (string(argv[i]) == "--output")
+            output_filename = argv[++i];
+        else if (string(argv[i]) == "--chunks")
+            nb_chunks = max(1, atoi(argv[++i]));
+        else
+            roi_values.push_back(atoi(argv[i]));
+    }
+    if (!roi_values.empty()) {
+        if (roi_values.size() != 4 || roi_values[2] <= 0 || roi_values[3] <= 0) {
+            cerr << "Invalid region of interest" << endl;
+            exit(1);
+        }
+        roi = Rect(roi_values[0], roi_values[1], roi_values[2], roi_values[3]);
+    }
+
     // we open the video file
     VideoCapture capture(video_filename);
 
@@ -38,11 +74,14 @@ int main(int argc, char** argv) {
     fs["image_Height"] >> image_height;
     Size image_size(image_width, image_height);
 
-    // we get the optimal new camera matrix
-    // needed to prevent the undistorted picture from being cropped
-    Mat newCameraMatrix = getOptimalNewCameraMatrix(cameraMatrix, distortionCoeffs, image_size, 0.5);
-    // Nota bene: it is possible to change the last parameter (alpha) of the previous function call
-    // between 0 and 1 depending on if we want the resulting image to be cropped or not
+    // we compute the remap tables once, instead of letting undistort compute them for each frame
+    Mat map1, map2;
+    if (!initUndistortMaps(cameraMatrix, distortionCoeffs, image_size, roi, map1, map2)) {
+        cerr << "The region of interest is outside of the frame (" << image_size.width << "x"
+             << image_size.height << ")" << endl;
+        exit(1);
+    }
+    cout << "undistorted frame size: " << map1.cols << "x" << map1.rows << endl;
 
     // we compute the frame duration
     int FPS = capture.get(CV_CAP_PROP_FPS);
@@ -51,6 +90,23 @@ int main(int argc, char** argv) {
     int frame_duration = 1000 / FPS;  // frame duration in milliseconds
     cout << "frame duration: " << frame_duration << " ms" << endl;
 
+    // batch mode: we write the undistorted video file
+    if (!output_filename.empty()) {
+        double video_duration = capture.get(CV_CAP_PROP_FRAME_COUNT) / capture.get(CV_CAP_PROP_FPS);
+        capture.release();
+
+        auto start_time = chrono::high_resolution_clock::now();
+        bool ok = transcodeUndistorted(video_filename, output_filename, map1, map2, nb_chunks);
+        auto end_time = chrono::high_resolution_clock::now();
+
+        double duration = chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count() / 1000.0;
+        cout << "transcoding time: " << duration << " s";
+        if (duration > 0)
+            cout << " (" << video_duration / duration << " times real-time)";
+        cout << endl;
+        return ok ? 0 : 1;
+    }
+
     // we read and display the video file, image after image
     Mat frame, frame_undistorted;
     namedWindow(video_filename, WINDOW_AUTOSIZE);
@@ -64,7 +120,7 @@ int main(int argc, char** argv) {
             break;
 
         // we undistort the frame
-        undistort(frame, frame_undistorted, cameraMatrix, distortionCoeffs, newCameraMatrix);
+        remap(frame, frame_undistorted, map1, map2, INTER_LINEAR);
 
         // we display the image
         imshow(video_filename, frame_undistorted);
@@ -0,0 +1,273 @@
+#include "transcoder.h"
+#include "undistortion.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+
+// a queue of frames between two stages of the pipeline:
+// push waits while the queue is full, pop waits while the queue is empty,
+// and pop returns false once the queue has been closed and emptied
+class FrameQueue {
+public:
+    FrameQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+    void push(const Mat& frame) {
+        unique_lock<mutex> lock(queue_mutex);
+        not_full.wait(lock, [this] { return frames.size() < capacity; });
+        frames.push_back(frame);
+        not_empty.notify_one();
+    }
+
+    bool pop(Mat& frame) {
+        unique_lock<mutex> lock(queue_mutex);
+        not_empty.wait(lock, [this] { return !frames.empty() || closed; });
+        if (frames.empty())
+            return false;
+        frame = frames.front();
+        frames.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    // called by the producer when there will be no more frames
+    void close() {
+        lock_guard<mutex> lock(queue_mutex);
+        closed = true;
+        not_empty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    bool closed;
+    deque<Mat> frames;
+    mutex queue_mutex;
+    condition_variable not_full, not_empty;
+};
+
+// what a chunk worker has to do, and what it did
+struct Chunk {
+    int first_frame;
+    int last_frame;  // excluded
+    string filename;
+    int nb_frames_written;
+    bool ok;
+};
+
+
+// returns the filename of a chunk: "dir/video.avi" -> "dir/video.part003.avi"
+static string chunkFilename(const string& output_filename, int chunk_number) {
+    ostringstream ss;
+    ss << ".part" << setw(3) << setfill('0') << chunk_number;
+
+    size_t dot   = output_filename.find_last_of('.');
+    size_t slash = output_filename.find_last_of('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return output_filename + ss.str();
+    return output_filename.substr(0, dot) + ss.str() + output_filename.substr(dot);
+}
+
+// returns the filename without the directories: "dir/video.avi" -> "video.avi"
+static string baseFilename(const string& filename) {
+    size_t slash = filename.find_last_of('/');
+    return slash == string::npos ? filename : filename.substr(slash + 1);
+}
+
+// returns the string between single quotes, for the shell and for the list file of the concat
+// demuxer of ffmpeg: nothing is interpreted inside, and a quote is written '\'' (both use the
+// same syntax): "it's.avi" -> 'it'\''s.avi'
+static string quoted(const string& s) {
+    string result = "'";
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '\'')
+            result += "'\\''";
+        else
+            result += s[i];
+    }
+    return result + "'";
+}
+
+/**
+    Undistort and encode a range of frames of the video into a chunk file.
+    Decoding, remap and encoding are three stages of a pipeline, each one in its own thread,
+    so that they overlap
+
+    @param video_filename The input video
+    @param map1 The first remap table computed by initUndistortMaps
+    @param map2 The second remap table computed by initUndistortMaps
+    @param fps The framerate of the output chunk
+    @param chunk The range of frames to process, and the output filename
+*/
+static void transcodeChunk(const string& video_filename, const Mat& map1, const Mat& map2,
+                           double fps, Chunk* chunk) {
+    chunk->ok = false;
+    chunk->nb_frames_written = 0;
+
+    // each chunk has its own decoder, which starts at the first frame of the chunk
+    VideoCapture capture(video_filename);
+    if (!capture.isOpened()) {
+        cerr << "Error when reading video file for chunk " << chunk->filename << endl;
+        return;
+    }
+    if (chunk->first_frame > 0) {
+        // the seek is frame accurate only with some backends: we check where it landed
+        capture.set(CV_CAP_PROP_POS_FRAMES, chunk->first_frame);
+        int position = (int)capture.get(CV_CAP_PROP_POS_FRAMES);
+        if (position != chunk->first_frame) {
+            cerr << "Error when seeking to frame " << chunk->first_frame << " for chunk "
+                 << chunk->filename << " (landed on frame " << position << ")" << endl;
+            return;
+        }
+    }
+
+    // Motion-JPEG: fast to encode, and the chunks can be joined without re-encoding
+    VideoWriter writer(chunk->filename, CV_FOURCC('M','J','P','G'), fps, map1.size());
+    if (!writer.isOpened()) {
+        cerr << "Error when opening output file " << chunk->filename << endl;
+        return;
+    }
+
+    FrameQueue decoded(PIPELINE_QUEUE_SIZE), undistorted(PIPELINE_QUEUE_SIZE);
+
+    // first stage: decoding
+    thread decoder([&]() {
+        for (int i = chunk->first_frame; i < chunk->last_frame; i++) {
+            Mat frame;  // a new Mat for each frame, because the previous one may still be in the queue
+            capture >> frame;
+            if (frame.empty())
+                break;
+            decoded.push(frame);
+        }
+        decoded.close();
+    });
+
+    // last stage: encoding
+    thread encoder([&]() {
+        Mat frame_undistorted;
+        while (undistorted.pop(frame_undistorted)) {
+            writer << frame_undistorted;
+            chunk->nb_frames_written++;
+        }
+    });
+
+    // second stage: the remap, by tiles in parallel
+    Mat frame;
+    while (decoded.pop(frame)) {
+        Mat frame_undistorted;
+        parallelRemap(frame, frame_undistorted, map1, map2);
+        undistorted.push(frame_undistorted);
+    }
+    undistorted.close();
+
+    decoder.join();
+    encoder.join();
+
+    // only the last chunk may end before its last frame (the frame count may be wrong):
+    // for the others, the frames not written would be missing in the joined video
+    if (chunk->last_frame != INT_MAX && chunk->nb_frames_written != chunk->last_frame - chunk->first_frame) {
+        cerr << "Error: chunk " << chunk->filename << " has " << chunk->nb_frames_written << " frames instead of "
+             << chunk->last_frame - chunk->first_frame << endl;
+        return;
+    }
+    chunk->ok = true;
+}
+
+// removes the files of the chunks
+static void removeChunks(const vector<Chunk>& chunks) {
+    for (size_t i = 0; i < chunks.size(); i++)
+        remove(chunks[i].filename.c_str());
+}
+
+/**
+    Write the undistorted video to a file. The video is split into chunks which are
+    decoded, undistorted and encoded in parallel, and the chunks are then joined
+    (without re-encoding) with ffmpeg
+
+    @param video_filename The input video
+    @param output_filename The output video (AVI, Motion-JPEG)
+    @param map1 The first remap table computed by initUndistortMaps
+    @param map2 The second remap table computed by initUndistortMaps
+    @param nb_chunks The number of chunks processed in parallel
+    @return false if a chunk could not be written, or if the chunks could not be joined
+*/
+bool transcodeUndistorted(const string& video_filename, const string& output_filename,
+                          const Mat& map1, const Mat& map2, int nb_chunks) {
+    VideoCapture capture(video_filename);
+    if (!capture.isOpened()) {
+        cerr << "Error when reading video file" << endl;
+        return false;
+    }
+    int nb_frames = (int)capture.get(CV_CAP_PROP_FRAME_COUNT);
+    double fps = capture.get(CV_CAP_PROP_FPS);
+    capture.release();
+
+    // the frame count given by the container may be wrong, so we don't split short videos
+    // and the last chunk always goes until the end of the video
+    if (nb_frames < nb_chunks * 2 * PIPELINE_QUEUE_SIZE)
+        nb_chunks = 1;
+
+    vector<Chunk> chunks(nb_chunks);
+    for (int i = 0; i < nb_chunks; i++) {
+        chunks[i].first_frame = (int)((long long)nb_frames * i / nb_chunks);
+        chunks[i].last_frame  = (i == nb_chunks - 1) ? INT_MAX : (int)((long long)nb_frames * (i+1) / nb_chunks);
+        chunks[i].filename = (nb_chunks == 1) ? output_filename : chunkFilename(output_filename, i);
+    }
+
+    cout << "transcoding " << nb_frames << " frames in " << nb_chunks << " chunks" << endl;
+
+    // we process all the chunks in parallel
+    vector<thread> workers;
+    for (int i = 0; i < nb_chunks; i++)
+        workers.push_back(thread(transcodeChunk, video_filename, cref(map1), cref(map2), fps, &chunks[i]));
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    int nb_frames_written = 0;
+    for (int i = 0; i < nb_chunks; i++) {
+        if (!chunks[i].ok) {
+            removeChunks(chunks);
+            return false;
+        }
+        nb_frames_written += chunks[i].nb_frames_written;
+    }
+    cout << nb_frames_written << " frames written" << endl;
+
+    if (nb_chunks == 1)
+        return true;
+
+    // we join the chunks with the concat demuxer of ffmpeg (the paths in the list file
+    // are relative to the list file, which is next to the chunks)
+    string list_filename = output_filename + ".parts.txt";
+    ofstream list_file(list_filename.c_str());
+    for (int i = 0; i < nb_chunks; i++)
+        list_file << "file " << quoted(baseFilename(chunks[i].filename)) << endl;
+    list_file.close();
+
+    string join_command = "ffmpeg -y -v error -f concat -safe 0 -i " + quoted(list_filename)
+                        + " -c copy " + quoted(output_filename);
+    if (system(join_command.c_str()) != 0) {
+        cerr << "Could not join the chunks, they are kept, to join them run:" << endl
+             << join_command << endl;
+        return false;
+    }
+
+    // the chunks are not needed anymore
+    removeChunks(chunks);
+    remove(list_filename.c_str());
+
+    return true;
+}
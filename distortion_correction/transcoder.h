@@ -0,0 +1,20 @@
+#ifndef TRANSCODER_H
+#define TRANSCODER_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <string>
+
+using namespace cv;
+using namespace std;
+
+// number of frames which can wait between two stages of the pipeline
+// (small, because each frame can be several MB)
+const int PIPELINE_QUEUE_SIZE = 4;
+
+
+bool transcodeUndistorted(const string& video_filename, const string& output_filename,
+                          const Mat& map1, const Mat& map2, int nb_chunks);
+
+
+#endif
@@ -0,0 +1,83 @@
+#include "undistortion.h"
+
+using namespace cv;
+using namespace std;
+
+
+/**
+    Compute the remap tables to undistort the frames, for the whole frame
+    or only for a region of interest of the undistorted frame
+
+    @param cameraMatrix The camera matrix, from the calibration file
+    @param distortionCoeffs The distortion coefficients, from the calibration file
+    @param image_size The size of the frames
+    @param roi The region to keep, in the coordinates of the undistorted frame
+               (an empty Rect to keep the whole frame)
+    @param map1 The output first remap table (fixed-point coordinates)
+    @param map2 The output second remap table (interpolation coefficients)
+    @return false if the ROI is outside of the frame
+*/
+bool initUndistortMaps(const Mat& cameraMatrix, const Mat& distortionCoeffs, Size image_size,
+                       Rect roi, Mat& map1, Mat& map2) {
+    // we get the optimal new camera matrix
+    // needed to prevent the undistorted picture from being cropped
+    Mat newCameraMatrix = getOptimalNewCameraMatrix(cameraMatrix, distortionCoeffs, image_size, 0.5);
+    // Nota bene: it is possible to change the last parameter (alpha) of the previous function call
+    // between 0 and 1 depending on if we want the resulting image to be cropped or not
+
+    Size output_size = image_size;
+    if (roi.area() > 0) {
+        // the ROI must be inside the undistorted frame
+        roi &= Rect(Point(0, 0), image_size);
+        if (roi.area() == 0)
+            return false;
+
+        // moving the principal point by the ROI offset gives an undistorted frame
+        // which starts at the top left corner of the ROI, so the remap tables
+        // are computed (and the remap is done) only for the pixels of the ROI
+        newCameraMatrix.at<double>(0,2) -= roi.x;
+        newCameraMatrix.at<double>(1,2) -= roi.y;
+        output_size = roi.size();
+    }
+
+    initUndistortRectifyMap(cameraMatrix, distortionCoeffs, Mat(), newCameraMatrix,
+                            output_size, CV_16SC2, map1, map2);
+    return true;
+}
+
+
+// remaps a group of tiles (bands of rows) of the undistorted frame
+class RemapBody : public ParallelLoopBody {
+public:
+    RemapBody(const Mat& frame, Mat& frame_undistorted, const Mat& map1, const Mat& map2)
+        : frame(frame), frame_undistorted(frame_undistorted), map1(map1), map2(map2) {}
+
+    void operator()(const Range& range) const {
+        Range rows(range.start * REMAP_TILE_ROWS, min(range.end * REMAP_TILE_ROWS, frame_undistorted.rows));
+
+        // the output is already allocated, so remap writes directly into it
+        Mat tile = frame_undistorted.rowRange(rows);
+        remap(frame, tile, map1.rowRange(rows), map2.rowRange(rows), INTER_LINEAR);
+    }
+
+private:
+    const Mat& frame;
+    Mat& frame_undistorted;
+    const Mat& map1;
+    const Mat& map2;
+};
+
+/**
+    Undistort a frame with precomputed remap tables, by tiles processed in parallel
+
+    @param frame The distorted frame
+    @param frame_undistorted The output undistorted frame
+    @param map1 The first remap table computed by initUndistortMaps
+    @param map2 The second remap table computed by initUndistortMaps
+*/
+void parallelRemap(const Mat& frame, Mat& frame_undistorted, const Mat& map1, const Mat& map2) {
+    frame_undistorted.create(map1.size(), frame.type());
+
+    int nb_tiles = (frame_undistorted.rows + REMAP_TILE_ROWS - 1) / REMAP_TILE_ROWS;
+    parallel_for_(Range(0, nb_tiles), RemapBody(frame, frame_undistorted, map1, map2));
+}
@@ -0,0 +1,19 @@
+#ifndef UNDISTORTION_H
+#define UNDISTORTION_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+
+using namespace cv;
+
+// number of rows of the undistorted frame remapped together by a thread
+const int REMAP_TILE_ROWS = 32;
+
+
+bool initUndistortMaps(const Mat& cameraMatrix, const Mat& distortionCoeffs, Size image_size,
+                       Rect roi, Mat& map1, Mat& map2);
+void parallelRemap(const Mat& frame, Mat& frame_undistorted, const Mat& map1, const Mat& map2);
+
+
+#endif
@@ -13,6 +13,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <memory>
+
+#include "../../camera_calibration/chessboard_detection.h"
+#include "../../camera_calibration/corner_cache.h"
+#include "../capture/frame_source.h"
 
 using namespace cv;
 using namespace std;
@@ -35,11 +40,15 @@ static int print_help()
             "       program to get the images when the chessboard pattern is found. \n"
             "       with w1: the number of the first webcam to use \n"
             "            w2: the number of the second webcam to use \n"
+            "       (or a video file, or a simulated camera like \"sim:input=left.avi\", \n"
+            "       see openFrameSource in ../capture/frame_source.cpp) \n"
             "   --image-list <file>: the XML/YML file containing the list of images, \n"
             "        if we don't use webcams \n"
             "   --input-dir <dir>: the directory containing the images\n"
             "                      (they will be read in alphabetical order)\n"
-            "   --save: save the images used for calibration in a folder\n" << endl;
+            "   --save: save the images used for calibration in a folder\n"
+            "   --cache: keep the chessboard corners found in the images in a cache\n"
+            "            (.corner-cache, used for --image-list and --input-dir)\n" << endl;
     return 0;
 }
 
@@ -59,10 +68,10 @@ public:
     INPUT_MODE inputMode = NONE;  // input mode for images
     string imageListFilename;  // only if input mode is an image list file (--image-list)
     string inputDir;  // directory to read images from, only if input mode is --input-dir
-    int webcam[2];  // the number of the webcams (only if input mode is webcam)
-    VideoCapture capture[2];  // the VideoCapture to access the webcam streams
+    string webcam[2];  // the number of the webcams, or the sources (only if input mode is webcam)
     int imageNumber = 10; // number of images to get (for each cam) if input mode is webcam
     bool save = false;  // save the calibration pictures
+    bool cornerCache = false;  // keep the corners found in the pictures in a cache (not for the webcams)
     string images_output_folder = "images_calib";  // folder where to save the pictures
     // WARNING: images will not be saved if the images_output_folder doesn't exist,
     //          it must be created by the user
@@ -125,12 +134,8 @@ int main(int argc, char** argv)
                 cout << "missing webcam numbers after --webcam" << endl;
                 return print_help();
             }
-            else if( sscanf(argv[++i], "%d", &settings.webcam[0]) != 1 || settings.webcam[0] < 0 ||
-                sscanf(argv[++i], "%d", &settings.webcam[1]) != 1 || settings.webcam[1] < 0)
-            {
-                cout << "invalid webcam number" << endl;
-                return print_help();
-            }
+            settings.webcam[0] = argv[++i];
+            settings.webcam[1] = argv[++i];
             settings.inputMode = WEBCAM;
         }
         else if (string(argv[i]) == "--input-dir" ) {
@@ -144,6 +149,9 @@ int main(int argc, char** argv)
         else if (string(argv[i]) == "--save" ) {
             settings.save = true;
         }
+        else if (string(argv[i]) == "--cache" ) {
+            settings.cornerCache = true;
+        }
         // invalid options or parameters
         else if( string(argv[i]) == "-h" || string(argv[i]) == "--help" )
             return print_help();
@@ -224,6 +232,18 @@ static void StereoCalib(const vector<Mat>& images, Settings settings)
     imagePoints[1].resize(nimages);
     vector<Mat> goodImages;
 
+    // the corners found in a picture are kept in a cache, under a hash of the pixels of the picture
+    // and of the detection parameters (see corner_cache.h), so they are not searched again when
+    // the program is run again on the same pictures
+    bool useCache = settings.cornerCache && settings.inputMode != WEBCAM;
+    corner_detection_params cacheParams;
+    cacheParams.pattern = CORNER_CACHE_PATTERN_CHESSBOARD;
+    cacheParams.board_size = settings.boardSize;
+    cacheParams.flags = CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_NORMALIZE_IMAGE;
+    cacheParams.refine_window = 11;
+    cacheParams.refine_epsilon = 0.01f;
+    cacheParams.flip = 0;
+
     // loop on all the pictures
     // (outer loop iterates only on the pictures from one of the two cameras)
     for( i = j = 0; i < nimages; i++ )
@@ -246,7 +266,22 @@ static void StereoCalib(const vector<Mat>& images, Settings settings)
 
             bool found = false;
             vector<Point2f>& corners = imagePoints[k][j];
-            for( int scale = 1; scale <= maxScale; scale++ )
+
+            uint64 cacheKey = 0;
+            corner_cache_entry cacheEntry;
+            bool cached = false;
+            if( useCache )
+            {
+                cacheKey = cornerCacheKey(img, cacheParams);
+                cached = loadCachedCorners(cacheKey, cacheParams, cacheEntry);
+                if( cached )
+                {
+                    found = cacheEntry.found;
+                    corners = cacheEntry.corners;
+                }
+            }
+
+            for( int scale = 1; !cached && scale <= maxScale; scale++ )
             {
                 Mat timg;
                 // we resize the picture if necessary
@@ -255,9 +290,14 @@ static void StereoCalib(const vector<Mat>& images, Settings settings)
                 else
                     resize(img, timg, Size(), scale, scale);
 
-                // we search for the chessboard corners
-                found = findChessboardCorners(timg, settings.boardSize, corners,
-                                                CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_NORMALIZE_IMAGE);
+                // we search for the chessboard corners (on a reduced picture first
+                // for the big pictures, see chessboard_detection.cpp)
+                if( scale == 1 )
+                    found = findChessboardCoarseToFine(timg, settings.boardSize, corners,
+                                                    CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_NORMALIZE_IMAGE);
+                else
+                    found = findChessboardCorners(timg, settings.boardSize, corners,
+                                                    CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_NORMALIZE_IMAGE);
                 if( found )
                 {
                     // if the picture was scaled, we scale back the corner coordinates
@@ -286,12 +326,24 @@ static void StereoCalib(const vector<Mat>& images, Settings settings)
             else
                 putchar('.');
 
+            // if we found the corners, we refine the corner locations
+            // (the corners of the cache are already refined)
+            if( found && !cached )
+                cornerSubPix(img, corners, Size(cacheParams.refine_window, cacheParams.refine_window), Size(-1,-1),
+                             TermCriteria(CV_TERMCRIT_ITER+CV_TERMCRIT_EPS, 30, cacheParams.refine_epsilon));
+
+            // the failures are cached too
+            if( useCache && !cached )
+            {
+                cacheEntry.found = found;
+                cacheEntry.image_size = img.size();
+                cacheEntry.corners = found ? corners : vector<Point2f>();
+                if( !saveCachedCorners(cacheKey, cacheParams, cacheEntry) )
+                    cout << "can not write the corner cache entry of the image number " << i*2+k << endl;
+            }
+
             if( !found )
                 break;
-
-            // if we found the corners, we refine the corner locations
-            cornerSubPix(img, corners, Size(11,11), Size(-1,-1),
-                         TermCriteria(CV_TERMCRIT_ITER+CV_TERMCRIT_EPS, 30, 0.01));
         }
         // if we found the corners in each of the two pictures,
         // we add them to the good images list
@@ -513,11 +565,12 @@ static void StereoCalib(const vector<Mat>& images, Settings settings)
 // @param settings -> the settings
 // @param images -> the output list of images
 static void getImagesFromWebcams(Settings settings, vector<Mat>& images) {
-    // we initialize the webcams
-    settings.capture[0] = VideoCapture(settings.webcam[0]);
-    settings.capture[1] = VideoCapture(settings.webcam[1]);
+    // we initialize the webcams (or the videos, or the simulated cameras)
+    unique_ptr<FrameSource> capture[2];
+    capture[0].reset(openFrameSource(settings.webcam[0], 0));
+    capture[1].reset(openFrameSource(settings.webcam[1], 1));
 
-    if (!settings.capture[0].isOpened() || !settings.capture[1].isOpened()) {
+    if (!capture[0]->isOpened() || !capture[1]->isOpened()) {
         cerr << "Error: can't access webcam stream" << endl;
         exit(1);
     }
@@ -539,10 +592,12 @@ static void getImagesFromWebcams(Settings settings, vector<Mat>& images) {
     Mat frameCam1, frameCam2;
     while (images.size()/2 < settings.imageNumber) {
         // we get new frames
-        settings.capture[0].grab();
-        settings.capture[1].grab();
-        settings.capture[0].retrieve(frameCam1);
-        settings.capture[1].retrieve(frameCam2);
+        if (!capture[0]->grab() || !capture[1]->grab()) {
+            cerr << "Error: no more frames from the webcams" << endl;
+            exit(1);
+        }
+        capture[0]->retrieve(frameCam1);
+        capture[1]->retrieve(frameCam2);
 
         if (detectionMode) {
             bool found1 = findChessboardCorners(frameCam1, settings.boardSize, corners1,
@@ -0,0 +1,100 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <memory>
+
+#include "capture_engine.h"
+
+using namespace cv;
+using namespace std;
+
+// to display the frames of the cameras, define "CAPTURE_DISPLAY"
+// #define CAPTURE_DISPLAY
+
+const int NB_SETS = 200;  // number of sets of frames to get
+
+
+static void help()
+{
+    cout << "This program gets synchronized frames from several cameras with the capture engine\n"
+            "(one thread per camera, see capture_engine.h), and prints the framerate, the skew\n"
+            "between the frames of each set and the latency.\n"
+            "Usage:  ./capture-demo [<source> <source> ...]  (default: cameras 1 and 2)\n"
+            "A source is a camera number, a video file, or a simulated camera like\n"
+            "\"sim:fps=30,jitter=2,drop=0.01,buffer=4\" (see openFrameSource in frame_source.cpp)" << endl;
+}
+
+int main(int argc, char** argv)
+{
+    help();
+
+    vector<string> specs;
+    for (int i = 1; i < argc; i++)
+        specs.push_back(argv[i]);
+    if (specs.empty()) {
+        specs.push_back("1");
+        specs.push_back("2");
+    }
+
+    // we open the webcam streams (or the videos, or the simulated cameras)
+    vector<unique_ptr<FrameSource> > sources;
+    vector<FrameSource*> source_pointers;
+    for (size_t i = 0; i < specs.size(); i++) {
+        sources.push_back(unique_ptr<FrameSource>(openFrameSource(specs[i], (int)i)));
+        if (!sources[i]->isOpened()) {
+            cerr << "Error: can't access stream " << specs[i] << endl;
+            return 1;
+        }
+        source_pointers.push_back(sources[i].get());
+    }
+
+    CaptureEngine engine(source_pointers);
+    engine.start();
+
+    vector<const timestamped_frame*> frames;
+    int64 start = captureClock();
+    double skew_sum = 0, latency_sum = 0;
+    int nb_sets = 0;
+
+    while (nb_sets < NB_SETS && engine.nextFrames(frames)) {
+        // latency: time since the grab of the newest frame of the set
+        int64 newest = frames[0]->timestamp;
+        for (size_t i = 1; i < frames.size(); i++)
+            newest = MAX(newest, frames[i]->timestamp);
+        double latency = (captureClock() - newest) * 1e-6;
+        double skew = engine.last_skew * 1e-6;
+        skew_sum += skew;
+        latency_sum += latency;
+        nb_sets++;
+
+        cout << "set " << nb_sets << ": skew " << skew << " ms, latency " << latency << " ms" << endl;
+
+        #ifdef CAPTURE_DISPLAY
+            // the frames are displayed directly from the buffers of the engine, without copy
+            for (size_t i = 0; i < frames.size(); i++) {
+                ostringstream window_name;
+                window_name << "camera " << specs[i];
+                imshow(window_name.str(), frames[i]->image);
+            }
+            if ((char)waitKey(1) == 27)
+                break;
+        #endif
+    }
+
+    double duration = (captureClock() - start) * 1e-9;
+    engine.stop();
+
+    if (nb_sets == 0) {
+        cerr << "Error: no set of frames" << endl;
+        return 1;
+    }
+    cout << endl << nb_sets / duration << " FPS (sets of frames), mean skew " << skew_sum / nb_sets
+         << " ms, mean latency " << latency_sum / nb_sets << " ms, "
+         << engine.nb_rejected_sets << " sets rejected because of the skew" << endl;
+    for (int i = 0; i < engine.nbCameras(); i++)
+        cout << "grabbed from camera " << specs[i] << ": " << engine.nbGrabbed(i) << endl;
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include "capture_engine.h"
+
+#include <chrono>
+
+using namespace cv;
+using namespace std;
+
+
+// the flag of the middle index of the triple buffer, set when the middle buffer has a new frame
+const int MIDDLE_NEW = 4;
+
+
+TripleBuffer::TripleBuffer() : write_index(0), read_index(1), middle(2) {
+    for (int i = 0; i < 3; i++) {
+        buffers[i].timestamp = 0;
+        buffers[i].number = -1;
+    }
+}
+
+/**
+    Publish the frame of the write buffer: it becomes the middle buffer, and the writer gets
+    the previous middle buffer (if the reader didn't read it, that frame is dropped)
+*/
+void TripleBuffer::publish() {
+    // release: the frame written in the buffer is visible to the reader which gets the buffer
+    int previous = middle.exchange(write_index | MIDDLE_NEW, memory_order_acq_rel);
+    write_index = previous & ~MIDDLE_NEW;
+}
+
+/**
+    Get the last published frame, if it was not read yet
+
+    @return true if readBuffer() is a new frame
+*/
+bool TripleBuffer::update() {
+    if ((middle.load(memory_order_relaxed) & MIDDLE_NEW) == 0)
+        return false;
+    // acquire: we see the frame written by the writer before it published the buffer
+    int previous = middle.exchange(read_index, memory_order_acq_rel);
+    read_index = previous & ~MIDDLE_NEW;
+    return true;
+}
+
+
+/**
+    @param sources The opened cameras (not owned by the engine, they must stay open while it runs)
+    @param max_skew The maximum difference between the timestamps of the frames of a set (nanoseconds)
+*/
+CaptureEngine::CaptureEngine(const vector<FrameSource*>& sources, int64 max_skew)
+    : nb_sets(0), nb_rejected_sets(0), last_skew(0), max_skew(max_skew), running(false), nb_published(0) {
+    for (size_t i = 0; i < sources.size(); i++) {
+        cameras.push_back(unique_ptr<camera_stream>(new camera_stream()));
+        cameras[i]->source = sources[i];
+        cameras[i]->ended = false;
+        cameras[i]->nb_grabbed = 0;
+        cameras[i]->interval = 0;
+        cameras[i]->last_number = -1;
+    }
+}
+
+CaptureEngine::~CaptureEngine() {
+    stop();
+}
+
+/**
+    Start the threads of the cameras
+*/
+void CaptureEngine::start() {
+    if (running)
+        return;
+    running = true;
+    for (size_t i = 0; i < cameras.size(); i++)
+        cameras[i]->grabber = thread(&CaptureEngine::grab, this, (int)i);
+}
+
+/**
+    Stop the threads of the cameras (they finish the frame they are grabbing)
+*/
+void CaptureEngine::stop() {
+    if (!running)
+        return;
+    {
+        // under the mutex, so that the consumer can't miss the notification between
+        // its test of 'running' and its wait
+        lock_guard<mutex> guard(wakeup_mutex);
+        running = false;
+    }
+    wakeup.notify_all();
+    for (size_t i = 0; i < cameras.size(); i++)
+        cameras[i]->grabber.join();
+}
+
+// the thread of a camera: the frames are grabbed and retrieved in the write buffer,
+// and published as soon as they are retrieved
+void CaptureEngine::grab(int camera) {
+    camera_stream& stream = *cameras[camera];
+    int64 number = 0;
+    int64 previous_timestamp = 0;
+    int nb_failed_grabs = 0;
+
+    while (running) {
+        // the image of the buffer is reused: no allocation if the size doesn't change
+        timestamped_frame& frame = stream.buffer.writeBuffer();
+        if (!stream.source->grab() || !stream.source->retrieve(frame.image)) {
+            if (++nb_failed_grabs >= CAPTURE_MAX_FAILED_GRABS) {
+                stream.ended = true;
+                break;
+            }
+            continue;
+        }
+        nb_failed_grabs = 0;
+        frame.timestamp = stream.source->timestamp();
+        frame.number = number++;
+
+        // we measure the time between two frames, with a running mean
+        if (previous_timestamp != 0) {
+            int64 interval = frame.timestamp - previous_timestamp;
+            int64 mean = stream.interval;
+            stream.interval = mean == 0 ? interval : (7 * mean + interval) / 8;
+        }
+        previous_timestamp = frame.timestamp;
+        stream.buffer.publish();
+        stream.nb_grabbed++;
+
+        {
+            lock_guard<mutex> guard(wakeup_mutex);
+            nb_published++;
+        }
+        wakeup.notify_one();
+    }
+
+    // the consumer must not wait for this camera any more
+    {
+        lock_guard<mutex> guard(wakeup_mutex);
+        nb_published++;
+    }
+    wakeup.notify_one();
+}
+
+// the maximum skew of a set: the one given to the constructor, or more if the cameras are
+// slower, so that the closest frames of free-running cameras are always accepted
+int64 CaptureEngine::maxSkew() const {
+    int64 interval = 0;
+    for (size_t i = 0; i < cameras.size(); i++)
+        interval = MAX(interval, (int64)cameras[i]->interval);
+    return MAX(max_skew, (int64)(interval * CAPTURE_SKEW_INTERVAL_RATIO));
+}
+
+/**
+    Wait for the newest set of frames, one per camera, all newer than the frames of the previous
+    set, and whose timestamps differ by less than the maximum skew (see maxSkew). When the timestamps of the
+    newest frames differ too much, we wait for the next frame of the late cameras
+
+    @param frames The output frames, in the order of the cameras: they are not copied, and they
+                  are valid until the next call to nextFrames
+    @param timeout_ms The maximum waiting time (milliseconds)
+    @return false if no set could be found before the timeout, or if a camera has ended
+*/
+bool CaptureEngine::nextFrames(vector<const timestamped_frame*>& frames, int timeout_ms) {
+    int n = (int)cameras.size();
+    frames.resize(n);
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+
+    unique_lock<mutex> guard(wakeup_mutex);
+    while (running) {
+        int64 seen = nb_published;
+        guard.unlock();
+
+        // the newest frame of each camera
+        bool all_new = true;
+        int64 oldest = 0, newest = 0;
+        for (int i = 0; i < n; i++) {
+            cameras[i]->buffer.update();
+            const timestamped_frame& frame = cameras[i]->buffer.readBuffer();
+            frames[i] = &frame;
+            if (frame.number <= cameras[i]->last_number) {
+                all_new = false;
+                if (cameras[i]->ended)
+                    return false;
+                continue;
+            }
+            if (i == 0 || frame.timestamp < oldest)
+                oldest = frame.timestamp;
+            if (i == 0 || frame.timestamp > newest)
+                newest = frame.timestamp;
+        }
+
+        if (all_new) {
+            int64 skew_bound = maxSkew();
+            if (newest - oldest <= skew_bound) {
+                for (int i = 0; i < n; i++)
+                    cameras[i]->last_number = frames[i]->number;
+                last_skew = newest - oldest;
+                nb_sets++;
+                return true;
+            }
+            // the oldest frames are dropped: the next frames of their cameras will be closer
+            nb_rejected_sets++;
+            for (int i = 0; i < n; i++)
+                if (newest - frames[i]->timestamp > skew_bound)
+                    cameras[i]->last_number = frames[i]->number;
+        }
+
+        // we wait for a camera to publish a new frame
+        guard.lock();
+        while (running && nb_published == seen)
+            if (wakeup.wait_until(guard, deadline) == cv_status::timeout)
+                return false;
+    }
+    return false;
+}
@@ -0,0 +1,112 @@
+#ifndef CAPTURE_ENGINE_H
+#define CAPTURE_ENGINE_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+#include "frame_source.h"
+
+using namespace cv;
+using namespace std;
+
+// maximum difference (nanoseconds) between the timestamps of the frames of a set:
+// about half of the time between two frames at 30 FPS
+const int64 CAPTURE_MAX_SKEW = 15000000;
+
+// the maximum skew is at least this fraction of the measured time between two frames: the cameras
+// run freely, with any phase offset, but the closest frames of two cameras are never more than half
+// of that time apart (the margin is for the jitter), so a set can always be found
+const double CAPTURE_SKEW_INTERVAL_RATIO = 0.6;
+
+// a camera has ended (end of a video file, or camera unplugged) after this number of failed grabs
+// (or retrieves) in a row
+const int CAPTURE_MAX_FAILED_GRABS = 10;
+
+
+// a frame of a camera, with the time it was grabbed
+typedef struct {
+    Mat image;
+    int64 timestamp;     // time of the frame given by its source (nanoseconds, monotonic clock of captureClock)
+    int64 number;        // number of the frame of the camera (-1 before the first frame)
+} timestamped_frame;
+
+
+// triple buffer between one writer (the thread of a camera) and one reader (the consumer),
+// without lock: the writer fills its buffer and swaps it with the middle one, the reader swaps
+// its buffer with the middle one when a new frame was published. Nothing is copied, and the
+// images of the buffers are reused, so there is no allocation after the first frames
+class TripleBuffer {
+public:
+    TripleBuffer();
+
+    // writer side
+    timestamped_frame& writeBuffer() { return buffers[write_index]; }
+    void publish();
+
+    // reader side: the frame of readBuffer() is valid until the next call to update
+    bool update();
+    const timestamped_frame& readBuffer() const { return buffers[read_index]; }
+
+private:
+    timestamped_frame buffers[3];
+    int write_index;             // used only by the writer
+    int read_index;              // used only by the reader
+    atomic<int> middle;          // index of the middle buffer, with MIDDLE_NEW if it was not read yet
+};
+
+
+// the state of a camera: its capture, its thread, and the buffer shared with the consumer
+typedef struct {
+    FrameSource* source;
+    TripleBuffer buffer;
+    thread grabber;
+    atomic<bool> ended;          // the camera can't give frames any more
+    atomic<int> nb_grabbed;      // number of frames grabbed by the thread
+    atomic<int64> interval;      // mean time between two frames (nanoseconds, 0 until measured)
+    int64 last_number;           // number of the frame of the last set given to the consumer
+} camera_stream;
+
+
+// synchronized capture on several cameras: one thread per camera grabs the frames as fast
+// as the camera gives them, and the consumer gets the newest set of frames (one per camera)
+// whose timestamps are close enough, without copy
+class CaptureEngine {
+public:
+    CaptureEngine(const vector<FrameSource*>& sources, int64 max_skew = CAPTURE_MAX_SKEW);
+    ~CaptureEngine();
+
+    void start();
+    void stop();
+    bool nextFrames(vector<const timestamped_frame*>& frames, int timeout_ms = 1000);
+
+    int nbCameras() const { return (int)cameras.size(); }
+    int nbGrabbed(int camera) const { return cameras[camera]->nb_grabbed; }
+
+    int nb_sets;                 // number of sets given to the consumer
+    int nb_rejected_sets;        // number of sets of new frames rejected because of the skew
+    int64 last_skew;             // skew of the last set given to the consumer (nanoseconds)
+
+private:
+    void grab(int camera);
+    int64 maxSkew() const;
+
+    vector<unique_ptr<camera_stream> > cameras;
+    int64 max_skew;
+    atomic<bool> running;
+
+    // only used to wake up the consumer, the frames are exchanged without lock
+    mutex wakeup_mutex;
+    condition_variable wakeup;
+    int64 nb_published;          // protected by wakeup_mutex
+};
+
+
+
+#endif
@@ -0,0 +1,292 @@
+#include "frame_source.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace cv;
+using namespace std;
+
+
+/**
+    @return The time of a monotonic clock, in nanoseconds (not the time of the day: only the
+            differences between two times are meaningful)
+*/
+int64 captureClock() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// we wait until a time of captureClock
+static void sleepUntil(int64 time) {
+    int64 delay = time - captureClock();
+    if (delay > 0)
+        this_thread::sleep_for(chrono::nanoseconds(delay));
+}
+
+// we read the list of pictures of a XML/YAML file (false if the file is not an image list)
+static bool readImageList(const string& filename, vector<string>& list) {
+    list.clear();
+    FileStorage fs;
+    try {
+        fs.open(filename, FileStorage::READ);
+    }
+    catch (...) {
+        return false;
+    }
+    if (!fs.isOpened())
+        return false;
+
+    FileNode n = fs.getFirstTopLevelNode();
+    if (n.type() != FileNode::SEQ)
+        return false;
+    for (FileNodeIterator it = n.begin(); it != n.end(); ++it)
+        list.push_back((string)*it);
+    return !list.empty();
+}
+
+
+CameraSource::CameraSource(int camera_number) : capture(camera_number), last_timestamp(0) {
+}
+
+CameraSource::CameraSource(const string& filename) : capture(filename), last_timestamp(0) {
+}
+
+bool CameraSource::grab() {
+    bool ok = capture.grab();
+    last_timestamp = captureClock();
+    return ok;
+}
+
+
+/**
+    Fill the parameters of a simulated camera with the values of a webcam: synthetic 640x480 frames
+    at 30 FPS, 1 ms of jitter, no drops, a buffer of 4 frames, and 2 ms to retrieve a frame
+
+    @param params The output parameters
+*/
+void defaultSimulatedCameraParams(simulated_camera_params& params) {
+    params.input = "";
+    params.loop = false;
+    params.size = Size(640, 480);
+    params.nb_frames = 0;
+    params.fps = 30;
+    params.offset = 0;
+    params.jitter = 1;
+    params.drop_rate = 0;
+    params.buffer_size = 4;
+    params.retrieve_time = 2;
+    params.seed = 0;
+}
+
+SimulatedCamera::SimulatedCamera(const simulated_camera_params& params)
+    : nb_produced(0), nb_dropped(0), nb_overflows(0), nb_grabbed(0),
+      params(params), opened(false), rng(params.seed != 0 ? params.seed : 1), next_index(0),
+      grabbed_index(-1), grabbed_time(0), video_position(0), video_base(0) {
+
+    if (params.input.empty())
+        opened = params.size.width > 0 && params.size.height > 0;
+    else if (readImageList(params.input, image_list)) {
+        opened = true;
+        if (!params.loop && this->params.nb_frames == 0)
+            this->params.nb_frames = (int)image_list.size();
+    }
+    else if (video.open(params.input)) {
+        opened = true;
+        int nb_video_frames = (int)video.get(CV_CAP_PROP_FRAME_COUNT);
+        if (!params.loop && this->params.nb_frames == 0 && nb_video_frames > 0)
+            this->params.nb_frames = nb_video_frames;
+    }
+
+    if (this->params.fps <= 0)
+        this->params.fps = 30;
+    if (this->params.buffer_size < 1)
+        this->params.buffer_size = 1;
+
+    start_time = captureClock();
+    next_arrival = arrivalTime(0);
+}
+
+// the arrival time of a frame of the camera (nanoseconds): its schedule given by the framerate
+// and the phase offset, with a gaussian jitter. The jitter doesn't accumulate from one frame to
+// the next, like the clock of a real camera, and it is limited to 40% of the period, so the
+// frames stay in order
+int64 SimulatedCamera::arrivalTime(int index) {
+    double period = 1e9 / params.fps;
+    double noise = rng.gaussian(params.jitter * 1e6);
+    noise = MIN(MAX(noise, -0.4 * period), 0.4 * period);
+    return start_time + (int64)(params.offset * 1e6 + (index + 1) * period + noise);
+}
+
+// the camera produces the frames which arrive before a time: they are lost by the camera
+// (drop rate) or by the driver (buffer full), or they wait in the buffer until they are grabbed
+void SimulatedCamera::produceUntil(int64 time) {
+    while (next_arrival <= time && (params.nb_frames == 0 || next_index < params.nb_frames)) {
+        if (params.drop_rate > 0 && rng.uniform(0., 1.) < params.drop_rate)
+            nb_dropped++;
+        else if ((int)buffer.size() >= params.buffer_size)
+            nb_overflows++;
+        else {
+            buffer.push_back(next_index);
+            buffer_times.push_back(next_arrival);
+        }
+        nb_produced++;
+        next_index++;
+        next_arrival = arrivalTime(next_index);
+    }
+}
+
+/**
+    Grab the oldest frame of the buffer of the driver, or wait for the next frame of the camera
+    if the buffer is empty
+
+    @return false if the camera has no more frames
+*/
+bool SimulatedCamera::grab() {
+    if (!opened)
+        return false;
+
+    produceUntil(captureClock());
+    while (buffer.empty()) {
+        if (params.nb_frames > 0 && next_index >= params.nb_frames)
+            return false;
+        sleepUntil(next_arrival);
+        produceUntil(next_arrival);
+    }
+
+    grabbed_index = buffer.front();
+    grabbed_time = buffer_times.front();
+    buffer.pop_front();
+    buffer_times.pop_front();
+    nb_grabbed++;
+    return true;
+}
+
+/**
+    Give the picture of the last grabbed frame, after the time of a retrieve of the driver
+
+    @param image The output picture (its memory is reused if it has the right size)
+    @return false if no frame was grabbed, or if the input has no more frames
+*/
+bool SimulatedCamera::retrieve(Mat& image) {
+    if (grabbed_index < 0)
+        return false;
+
+    this_thread::sleep_for(chrono::microseconds((int64)(params.retrieve_time * 1000)));
+    if (params.input.empty()) {
+        syntheticFrame(grabbed_index, image);
+        return true;
+    }
+    return sourceFrame(grabbed_index, image);
+}
+
+// the picture of a frame of the replayed video or image list
+bool SimulatedCamera::sourceFrame(int index, Mat& image) {
+    if (!image_list.empty()) {
+        if (!params.loop && index >= (int)image_list.size())
+            return false;
+        image = imread(image_list[index % image_list.size()], CV_LOAD_IMAGE_COLOR);
+        return !image.empty();
+    }
+
+    // the frames lost by the camera are skipped in the video
+    int position = index - video_base;
+    while (video_position < position && video.grab())
+        video_position++;
+    if (video_position == position && video.read(image)) {
+        video_position++;
+        return true;
+    }
+    if (!params.loop)
+        return false;
+
+    // end of the video: we replay it from the start
+    video.set(CV_CAP_PROP_POS_FRAMES, 0);
+    video_base = index;
+    video_position = 0;
+    if (!video.read(image))
+        return false;
+    video_position = 1;
+    return true;
+}
+
+// a synthetic frame: a ball moving on a green background, with the number of the frame,
+// so the frames of two cameras can be compared
+void SimulatedCamera::syntheticFrame(int index, Mat& image) {
+    image.create(params.size, CV_8UC3);
+    image.setTo(Scalar(60, 110, 40));
+
+    int width = params.size.width, height = params.size.height;
+    Point ball((index * 7) % width, (int)(height / 2 + sin(index * 0.1) * height / 4));
+    circle(image, ball, 8, Scalar(255, 255, 255), -1);
+
+    ostringstream text;
+    text << index;
+    putText(image, text.str(), Point(10, 30), FONT_HERSHEY_SIMPLEX, 1, Scalar(255, 255, 255), 2);
+}
+
+
+/**
+    Open a source of frames from a description:
+    - a number: the camera with this number
+    - "sim:" followed by parameters "key=value" separated by commas: a simulated camera, with the keys
+      input (video or image list, synthetic frames if not given), loop (0 or 1), size (width x height,
+      like 640x480), frames, fps, offset (ms), jitter (ms), drop (probability), buffer, retrieve (ms)
+      and seed, for example "sim:fps=30,jitter=2,drop=0.01,buffer=4"
+    - anything else: a video file, read as fast as possible
+
+    @param spec The description of the source
+    @param number The number of the source among the sources of the program: the default seed of a
+                  simulated camera is number + 1, so two cameras with the same description have
+                  different jitters and drops, but the same ones on each run
+    @return The source (to delete by the caller), which may be not opened
+*/
+FrameSource* openFrameSource(const string& spec, int number) {
+    if (!spec.empty() && spec.find_first_not_of("0123456789") == string::npos)
+        return new CameraSource(atoi(spec.c_str()));
+    if (spec.compare(0, 4, "sim:") != 0)
+        return new CameraSource(spec);
+
+    simulated_camera_params params;
+    defaultSimulatedCameraParams(params);
+    stringstream parameters(spec.substr(4));
+    string parameter;
+    while (getline(parameters, parameter, ',')) {
+        size_t equal = parameter.find('=');
+        if (equal == string::npos) {
+            cerr << "simulated camera: parameter without value: " << parameter << endl;
+            continue;
+        }
+        string key = parameter.substr(0, equal);
+        string value = parameter.substr(equal + 1);
+
+        if (key == "input")            params.input = value;
+        else if (key == "loop")        params.loop = atoi(value.c_str()) != 0;
+        else if (key == "size") {
+            if (sscanf(value.c_str(), "%dx%d", &params.size.width, &params.size.height) != 2 ||
+                params.size.width <= 0 || params.size.height <= 0) {
+                // the camera is not opened with an empty size
+                cerr << "simulated camera: invalid size: " << value << endl;
+                params.size = Size(0, 0);
+            }
+        }
+        else if (key == "frames")      params.nb_frames = atoi(value.c_str());
+        else if (key == "fps")         params.fps = atof(value.c_str());
+        else if (key == "offset")      params.offset = atof(value.c_str());
+        else if (key == "jitter")      params.jitter = atof(value.c_str());
+        else if (key == "drop")        params.drop_rate = atof(value.c_str());
+        else if (key == "buffer")      params.buffer_size = atoi(value.c_str());
+        else if (key == "retrieve")    params.retrieve_time = atof(value.c_str());
+        else if (key == "seed")        params.seed = strtoull(value.c_str(), NULL, 10);
+        else
+            cerr << "simulated camera: unknown parameter: " << key << endl;
+    }
+    if (params.seed == 0)
+        params.seed = (uint64)number + 1;
+    return new SimulatedCamera(params);
+}
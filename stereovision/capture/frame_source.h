@@ -0,0 +1,110 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <string>
+#include <vector>
+#include <deque>
+
+using namespace cv;
+using namespace std;
+
+
+// a source of frames which behaves like a camera: grab waits for the next frame,
+// and retrieve gives the picture of the last grabbed frame
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+    virtual bool isOpened() const = 0;
+    virtual bool grab() = 0;
+    virtual bool retrieve(Mat& image) = 0;
+    // the time of the last grabbed frame (nanoseconds, monotonic clock of captureClock)
+    virtual int64 timestamp() const = 0;
+
+    bool read(Mat& image) { return grab() && retrieve(image); }
+};
+
+
+// a camera or a video file, read with VideoCapture
+class CameraSource : public FrameSource {
+public:
+    CameraSource(int camera_number);
+    CameraSource(const string& filename);
+    bool isOpened() const { return capture.isOpened(); }
+    bool grab();
+    bool retrieve(Mat& image) { return capture.retrieve(image); }
+    int64 timestamp() const { return last_timestamp; }
+
+private:
+    VideoCapture capture;
+    int64 last_timestamp;
+};
+
+
+// the behaviour of a simulated camera
+typedef struct {
+    string input;           // video file or image list (XML/YAML) to replay, empty for synthetic frames
+    bool loop;              // replay the input again when it ends
+    Size size;              // size of the synthetic frames
+    int nb_frames;          // number of frames given by the camera (0: no limit)
+    double fps;             // frames per second
+    double offset;          // phase offset of the frames (milliseconds), like the start of a free-running camera
+    double jitter;          // standard deviation of the arrival time of a frame around its schedule (milliseconds)
+    double drop_rate;       // probability that the camera loses a frame
+    int buffer_size;        // number of frames kept by the driver until they are grabbed
+    double retrieve_time;   // time taken by retrieve (milliseconds), like the conversion of the driver
+    uint64 seed;            // seed of the random numbers (jitter and drops), for reproducible runs
+                            // (0: the number of the source given to openFrameSource, plus 1)
+} simulated_camera_params;
+
+void defaultSimulatedCameraParams(simulated_camera_params& params);
+
+
+// a camera simulated on a video, an image list, or synthetic frames: the frames arrive at the given
+// framerate (with jitter and drops), they wait in the buffer of the "driver" until they are grabbed
+// (when the buffer is full, the new frames are lost, and the grabbed frames are old), and grab waits
+// for the next frame when the buffer is empty
+class SimulatedCamera : public FrameSource {
+public:
+    SimulatedCamera(const simulated_camera_params& params);
+    bool isOpened() const { return opened; }
+    bool grab();
+    bool retrieve(Mat& image);
+    int64 timestamp() const { return grabbed_time; }
+
+    int nb_produced;        // frames produced by the camera
+    int nb_dropped;         // frames lost by the camera
+    int nb_overflows;       // frames lost because the buffer of the driver was full
+    int nb_grabbed;
+
+private:
+    void produceUntil(int64 time);
+    int64 arrivalTime(int index);
+    bool sourceFrame(int index, Mat& image);
+    void syntheticFrame(int index, Mat& image);
+
+    simulated_camera_params params;
+    bool opened;
+    RNG rng;
+    int64 start_time;
+    int64 next_arrival;     // arrival time of the next frame of the camera
+    int next_index;         // index of the next frame of the camera
+    deque<int> buffer;      // indexes of the frames waiting in the driver
+    deque<int64> buffer_times;
+    int grabbed_index;      // index of the last grabbed frame (-1 if none)
+    int64 grabbed_time;     // arrival time of the last grabbed frame
+
+    VideoCapture video;     // replayed video
+    int video_position;     // index of the next frame of the video
+    int video_base;         // index of the frame at the start of the current replay of the video
+    vector<string> image_list;
+};
+
+
+int64 captureClock();
+FrameSource* openFrameSource(const string& spec, int number = 0);
+
+
+#endif
@@ -0,0 +1,429 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <stdlib.h>
+
+#include "../../capture/capture_engine.h"
+#include "../../capture/frame_source.h"
+#include "../../../ball_tracking/ball_tracking.h"
+
+using namespace cv;
+using namespace std;
+
+const int NB_SETS = 200;  // default number of sets of frames processed by each strategy
+
+
+// the processing done on each frame of a set, in the thread which gets the frames
+enum LoadType {
+    LOAD_NONE,  // no processing: only the capture is measured
+    LOAD_SPIN,  // a busy loop of a fixed duration, like a processing of constant cost
+    LOAD_BALL   // the ball tracking of ball_tracking.cpp, one tracker per camera
+};
+
+typedef struct {
+    LoadType type;
+    double spin_time;  // duration of the busy loop for each frame (milliseconds)
+} processing_load;
+
+// the measures of one strategy
+typedef struct {
+    int nb_sets;             // number of sets of frames processed
+    double duration;         // seconds
+    double latency_sum;      // capture-to-process latency, summed over the sets (milliseconds)
+    double latency_max;
+    double skew_sum;         // difference between the timestamps of the frames of a set (milliseconds)
+    double skew_max;
+    int nb_ball_found;       // frames where the ball tracker found the ball
+    vector<int> nb_grabbed;  // frames grabbed by each camera
+} benchmark_result;
+
+
+static void help()
+{
+    cout << "This program measures the capture of synchronized frames from several cameras\n"
+            "with three strategies, while a processing is done on each set of frames:\n"
+            "    sequential: grab on all the cameras, then retrieve, then process (like \"grab then retrieve\")\n"
+            "    threaded:   one thread per camera, exchanging a copy of the frame under a mutex (like \"threads\")\n"
+            "    pipeline:   the capture engine, with lock-free triple buffers (see ../../capture)\n"
+            "It prints the framerate of the processed sets, the capture-to-process latency and the skew\n"
+            "between the frames of each set.\n"
+            "Usage:  ./main [--strategy all|sequential|threaded|pipeline] [--load none|spin:<ms>|ball]\n"
+            "               [--sets <number>] [<source> <source> ...]\n"
+            "A source is a camera number, a video file, or a simulated camera like \"sim:fps=30,jitter=2\"\n"
+            "(see openFrameSource in frame_source.cpp), default: \"sim:fps=30\" \"sim:fps=30,offset=10\".\n"
+            "The load \"spin:10\" takes 10 ms per frame, \"ball\" runs the ball tracker on each frame" << endl;
+}
+
+/**
+    Read the description of the processing load: "none", "spin:<ms>" or "ball"
+
+    @param spec The description
+    @param load The output load
+    @return false if the description is not valid
+*/
+static bool parseLoad(const string& spec, processing_load& load) {
+    load.spin_time = 0;
+    if (spec == "none")
+        load.type = LOAD_NONE;
+    else if (spec == "ball")
+        load.type = LOAD_BALL;
+    else if (spec.compare(0, 5, "spin:") == 0) {
+        load.type = LOAD_SPIN;
+        load.spin_time = atof(spec.c_str() + 5);
+    }
+    else
+        return false;
+    return true;
+}
+
+// opens all the sources, they are opened again for each strategy so that each one
+// starts with new cameras (and the same simulated frames)
+static bool openSources(const vector<string>& specs, vector<unique_ptr<FrameSource> >& sources) {
+    sources.clear();
+    for (size_t i = 0; i < specs.size(); i++) {
+        sources.push_back(unique_ptr<FrameSource>(openFrameSource(specs[i], (int)i)));
+        if (!sources[i]->isOpened()) {
+            cerr << "Error: can't access stream " << specs[i] << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// the processing of the sets of frames, and the measures, common to all the strategies
+class SetProcessor {
+public:
+    SetProcessor(const processing_load& load, int nb_cameras);
+    void process(const vector<const Mat*>& images, const vector<int64>& timestamps);
+    void finish(benchmark_result& result);
+
+private:
+    processing_load load;
+    vector<BallTracker> trackers;
+    int64 start;
+    benchmark_result measures;
+};
+
+SetProcessor::SetProcessor(const processing_load& load, int nb_cameras)
+    : load(load), trackers(load.type == LOAD_BALL ? nb_cameras : 0) {
+    measures.nb_sets = 0;
+    measures.latency_sum = measures.latency_max = 0;
+    measures.skew_sum = measures.skew_max = 0;
+    measures.nb_ball_found = 0;
+    start = captureClock();
+}
+
+/**
+    Process a set of frames (one per camera), and measure it
+
+    @param images The frames of the set
+    @param timestamps The timestamps of the frames, given by their sources
+*/
+void SetProcessor::process(const vector<const Mat*>& images, const vector<int64>& timestamps) {
+    for (size_t i = 0; i < images.size(); i++) {
+        if (load.type == LOAD_SPIN) {
+            // we keep the processor busy, like a real processing would
+            int64 end = captureClock() + (int64)(load.spin_time * 1e6);
+            while (captureClock() < end)
+                ;
+        }
+        else if (load.type == LOAD_BALL)
+            measures.nb_ball_found += trackers[i].processFrame(*images[i]);
+    }
+
+    // the latency is the time since the capture of the oldest frame, until its processing is done
+    int64 now = captureClock();
+    int64 oldest = timestamps[0], newest = timestamps[0];
+    for (size_t i = 1; i < timestamps.size(); i++) {
+        oldest = MIN(oldest, timestamps[i]);
+        newest = MAX(newest, timestamps[i]);
+    }
+    double latency = (now - oldest) * 1e-6;
+    double skew = (newest - oldest) * 1e-6;
+    measures.latency_sum += latency;
+    measures.latency_max = MAX(measures.latency_max, latency);
+    measures.skew_sum += skew;
+    measures.skew_max = MAX(measures.skew_max, skew);
+    measures.nb_sets++;
+}
+
+// gives the measures, since the creation of the processor
+void SetProcessor::finish(benchmark_result& result) {
+    measures.duration = (captureClock() - start) * 1e-9;
+    result = measures;
+}
+
+
+/**
+    The sequential strategy: we grab a frame from each camera, one after another (so that the frames
+    are as close as possible in time), then we retrieve them, then we process them
+
+    @param sources The cameras
+    @param load The processing done on each frame
+    @param nb_sets The number of sets of frames to process
+    @param result The output measures
+*/
+static void runSequential(vector<unique_ptr<FrameSource> >& sources, const processing_load& load,
+                          int nb_sets, benchmark_result& result) {
+    size_t nb_cameras = sources.size();
+    vector<Mat> frames(nb_cameras);
+    vector<const Mat*> images(nb_cameras);
+    vector<int64> timestamps(nb_cameras);
+    for (size_t i = 0; i < nb_cameras; i++)
+        images[i] = &frames[i];
+
+    SetProcessor processor(load, (int)nb_cameras);
+    bool ended = false;
+    while (!ended && nb_sets-- > 0) {
+        for (size_t i = 0; i < nb_cameras && !ended; i++) {
+            ended = !sources[i]->grab();
+            timestamps[i] = sources[i]->timestamp();
+        }
+        for (size_t i = 0; i < nb_cameras && !ended; i++)
+            ended = !sources[i]->retrieve(frames[i]);
+        if (!ended)
+            processor.process(images, timestamps);
+    }
+    processor.finish(result);
+    result.nb_grabbed.assign(nb_cameras, result.nb_sets);
+}
+
+
+// a camera of the threaded strategy: its thread waits for a request of the main thread,
+// grabs and retrieves a frame in the buffer, and waits for the next request
+typedef struct {
+    FrameSource* source;
+    mutex mutex_request;     // protects request_new_frame, buffer and timestamp
+    bool request_new_frame;  // set to true when we need a new frame from the camera
+    Mat buffer;
+    int64 timestamp;
+    atomic<bool> ended;      // the camera can't give frames any more
+    int nb_grabbed;
+    thread grabber;
+} threaded_camera;
+
+// the thread of a camera in the threaded strategy, like getNewFrame in threads/main.cpp
+static void getNewFrame(threaded_camera* camera, const atomic<bool>* running) {
+    while (*running && !camera->ended) {
+        // if the flag request_new_frame is false or locked by a mutex,
+        // we wait a few ms and then try again
+        if (!camera->mutex_request.try_lock()) {
+            this_thread::sleep_for(chrono::milliseconds(2));
+            continue;
+        }
+        if (!camera->request_new_frame) {
+            camera->mutex_request.unlock();
+            this_thread::sleep_for(chrono::milliseconds(2));
+            continue;
+        }
+
+        if (camera->source->grab() && camera->source->retrieve(camera->buffer)) {
+            camera->timestamp = camera->source->timestamp();
+            camera->nb_grabbed++;
+            camera->request_new_frame = false;
+        }
+        else
+            camera->ended = true;
+        camera->mutex_request.unlock();
+        this_thread::sleep_for(chrono::milliseconds(2));
+    }
+}
+
+/**
+    The threaded strategy of threads/main.cpp: one thread per camera, and the main thread polls
+    the mutexes every 2 ms until all the cameras have a new frame, copies the frames, and processes them
+
+    @param sources The cameras
+    @param load The processing done on each frame
+    @param nb_sets The number of sets of frames to process
+    @param result The output measures
+*/
+static void runThreaded(vector<unique_ptr<FrameSource> >& sources, const processing_load& load,
+                        int nb_sets, benchmark_result& result) {
+    size_t nb_cameras = sources.size();
+    vector<unique_ptr<threaded_camera> > cameras;
+    vector<Mat> frames(nb_cameras);
+    vector<const Mat*> images(nb_cameras);
+    vector<int64> timestamps(nb_cameras);
+    atomic<bool> running(true);
+
+    SetProcessor processor(load, (int)nb_cameras);
+    for (size_t i = 0; i < nb_cameras; i++) {
+        cameras.push_back(unique_ptr<threaded_camera>(new threaded_camera()));
+        threaded_camera* camera = cameras[i].get();
+        camera->source = sources[i].get();
+        camera->request_new_frame = true;
+        camera->timestamp = 0;
+        camera->ended = false;
+        camera->nb_grabbed = 0;
+        camera->grabber = thread(getNewFrame, camera, &running);
+        images[i] = &frames[i];
+    }
+
+    bool ended = false;
+    while (!ended && nb_sets-- > 0) {
+        // we lock the mutexes one after another, each one when its camera has a new frame,
+        // and we keep them locked until all the cameras have a new frame
+        size_t nb_locked = 0;
+        while (nb_locked < nb_cameras && !ended) {
+            threaded_camera* camera = cameras[nb_locked].get();
+            if (camera->mutex_request.try_lock()) {
+                if (!camera->request_new_frame) {
+                    nb_locked++;
+                    continue;
+                }
+                camera->mutex_request.unlock();
+            }
+            ended = camera->ended;
+            this_thread::sleep_for(chrono::milliseconds(2));
+        }
+
+        // we copy the frames, and then we release the mutexes, so that the other threads
+        // can get new frames while we are processing these ones
+        for (size_t i = 0; i < nb_locked; i++) {
+            if (!ended) {
+                cameras[i]->buffer.copyTo(frames[i]);
+                timestamps[i] = cameras[i]->timestamp;
+                cameras[i]->request_new_frame = true;
+            }
+            cameras[i]->mutex_request.unlock();
+        }
+
+        if (!ended)
+            processor.process(images, timestamps);
+    }
+    processor.finish(result);
+
+    running = false;
+    result.nb_grabbed.clear();
+    for (size_t i = 0; i < nb_cameras; i++) {
+        cameras[i]->grabber.join();
+        result.nb_grabbed.push_back(cameras[i]->nb_grabbed);
+    }
+}
+
+/**
+    The pipeline strategy: the capture engine grabs the frames in one thread per camera, and gives
+    the newest synchronized set through lock-free triple buffers, without copy (see capture_engine.cpp)
+
+    @param sources The cameras
+    @param load The processing done on each frame
+    @param nb_sets The number of sets of frames to process
+    @param result The output measures
+*/
+static void runPipeline(vector<unique_ptr<FrameSource> >& sources, const processing_load& load,
+                        int nb_sets, benchmark_result& result) {
+    size_t nb_cameras = sources.size();
+    vector<FrameSource*> source_pointers;
+    for (size_t i = 0; i < nb_cameras; i++)
+        source_pointers.push_back(sources[i].get());
+    vector<const timestamped_frame*> frames;
+    vector<const Mat*> images(nb_cameras);
+    vector<int64> timestamps(nb_cameras);
+
+    CaptureEngine engine(source_pointers);
+    SetProcessor processor(load, (int)nb_cameras);
+    engine.start();
+    while (nb_sets-- > 0 && engine.nextFrames(frames)) {
+        for (size_t i = 0; i < nb_cameras; i++) {
+            images[i] = &frames[i]->image;
+            timestamps[i] = frames[i]->timestamp;
+        }
+        processor.process(images, timestamps);
+    }
+    processor.finish(result);
+    engine.stop();
+
+    result.nb_grabbed.clear();
+    for (size_t i = 0; i < nb_cameras; i++)
+        result.nb_grabbed.push_back(engine.nbGrabbed((int)i));
+}
+
+
+static void printResult(const string& strategy, const processing_load& load, const benchmark_result& result) {
+    cout << setw(10) << left << strategy << right;
+    if (result.nb_sets == 0) {
+        cout << "  no set of frames" << endl;
+        return;
+    }
+    cout << fixed << setprecision(1)
+         << setw(8)  << result.nb_sets / result.duration << " FPS"
+         << setw(10) << result.latency_sum / result.nb_sets << " / " << setw(6) << result.latency_max << " ms"
+         << setw(10) << result.skew_sum / result.nb_sets    << " / " << setw(6) << result.skew_max << " ms"
+         << "    grabbed";
+    for (size_t i = 0; i < result.nb_grabbed.size(); i++)
+        cout << " " << result.nb_grabbed[i];
+    if (load.type == LOAD_BALL)
+        cout << ", ball found in " << result.nb_ball_found << " frames";
+    cout << endl;
+}
+
+int main(int argc, char** argv)
+{
+    string strategy = "all";
+    processing_load load;
+    parseLoad("none", load);
+    int nb_sets = NB_SETS;
+    vector<string> specs;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--strategy" && i + 1 < argc)
+            strategy = argv[++i];
+        else if (arg == "--load" && i + 1 < argc) {
+            if (!parseLoad(argv[++i], load)) {
+                help();
+                return 1;
+            }
+        }
+        else if (arg == "--sets" && i + 1 < argc)
+            nb_sets = atoi(argv[++i]);
+        else if (arg.compare(0, 2, "--") == 0) {
+            help();
+            return 1;
+        }
+        else
+            specs.push_back(arg);
+    }
+    if (strategy != "all" && strategy != "sequential" && strategy != "threaded" && strategy != "pipeline") {
+        help();
+        return 1;
+    }
+    if (specs.empty()) {
+        specs.push_back("sim:fps=30");
+        specs.push_back("sim:fps=30,offset=10");
+    }
+
+    cout << specs.size() << " cameras, " << nb_sets << " sets of frames per strategy" << endl << endl
+         << setw(10) << left << "strategy" << right << setw(12) << "framerate"
+         << setw(23) << "latency mean / max" << setw(22) << "skew mean / max" << endl;
+
+    static const char* strategies[] = { "sequential", "threaded", "pipeline" };
+    for (int s = 0; s < 3; s++) {
+        if (strategy != "all" && strategy != strategies[s])
+            continue;
+
+        vector<unique_ptr<FrameSource> > sources;
+        if (!openSources(specs, sources))
+            return 1;
+
+        benchmark_result result;
+        if (s == 0)
+            runSequential(sources, load, nb_sets, result);
+        else if (s == 1)
+            runThreaded(sources, load, nb_sets, result);
+        else
+            runPipeline(sources, load, nb_sets, result);
+        printResult(strategies[s], load, result);
+    }
+
+    return 0;
+}
@@ -2,20 +2,26 @@
 #include <opencv/highgui.h>
 #include <iostream>
 #include <chrono>
+#include <memory>
+
+#include "../../capture/frame_source.h"
 
 using namespace cv;
 using namespace std;
 
 
-void myGrab(int camNum, VideoCapture& captureCam);
-void myRetrieve(int camNum, VideoCapture& captureCam, Mat& frameCam);
+void myGrab(int camNum, FrameSource& captureCam);
+void myRetrieve(int camNum, FrameSource& captureCam, Mat& frameCam);
 
 
 int main(int argc, char const *argv[])
 {
-    // we open the webcam streams
-    VideoCapture captureCam1(1);
-    VideoCapture captureCam2(2);
+    // we open the webcam streams (cameras 1 and 2, or the sources given as arguments:
+    // camera numbers, videos, or simulated cameras, see openFrameSource in frame_source.cpp)
+    unique_ptr<FrameSource> source1(openFrameSource(argc >= 3 ? argv[1] : "1", 0));
+    unique_ptr<FrameSource> source2(openFrameSource(argc >= 3 ? argv[2] : "2", 1));
+    FrameSource& captureCam1 = *source1;
+    FrameSource& captureCam2 = *source2;
 
     if (!captureCam1.isOpened() || !captureCam2.isOpened()) {
         cerr << "Error: can't access webcam stream" << endl;
@@ -68,7 +74,7 @@ int main(int argc, char const *argv[])
 }
 
 
-void myGrab(int camNum, VideoCapture& capture) {
+void myGrab(int camNum, FrameSource& capture) {
     auto start_time = chrono::high_resolution_clock::now();
     bool grab = capture.grab();
     auto end_time = chrono::high_resolution_clock::now();
@@ -78,7 +84,7 @@ void myGrab(int camNum, VideoCapture& capture) {
         cout << endl << "GRAB FAILED cam number " << camNum << endl;
 }
 
-void myRetrieve(int camNum, VideoCapture& capture, Mat& frame) {
+void myRetrieve(int camNum, FrameSource& capture, Mat& frame) {
     auto start_time = chrono::high_resolution_clock::now();
     capture.retrieve(frame);
     auto end_time = chrono::high_resolution_clock::now();
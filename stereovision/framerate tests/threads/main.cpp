@@ -4,6 +4,9 @@
 #include <chrono>
 #include <thread>
 #include <mutex>
+#include <memory>
+
+#include "../../capture/frame_source.h"
 
 using namespace cv;
 using namespace std;
@@ -19,15 +22,18 @@ static int number_grab_1 = 0;
 static int number_grab_2 = 0;
 
 
-void getNewFrame(int camNum, VideoCapture* captureCam, Mat* frame,
+void getNewFrame(int camNum, FrameSource* captureCam, Mat* frame,
                     mutex *mutexRequestNewFrame, bool* requestNewFrame);
 
 
 int main(int argc, char const *argv[])
 {
-    // we open the webcam streams
-    VideoCapture captureCam1(1);
-    VideoCapture captureCam2(2);
+    // we open the webcam streams (cameras 1 and 2, or the sources given as arguments:
+    // camera numbers, videos, or simulated cameras, see openFrameSource in frame_source.cpp)
+    unique_ptr<FrameSource> source1(openFrameSource(argc >= 3 ? argv[1] : "1", 0));
+    unique_ptr<FrameSource> source2(openFrameSource(argc >= 3 ? argv[2] : "2", 1));
+    FrameSource& captureCam1 = *source1;
+    FrameSource& captureCam2 = *source2;
 
     if (!captureCam1.isOpened() || !captureCam2.isOpened()) {
         cerr << "Error: can't access webcam stream" << endl;
@@ -130,8 +136,8 @@ int main(int argc, char const *argv[])
 }
 
 
-// void getNewFrame(int camNum, VideoCapture* capture, Mat* frame) {
-void getNewFrame(int camNum, VideoCapture* capture, Mat* frame,
+// void getNewFrame(int camNum, FrameSource* capture, Mat* frame) {
+void getNewFrame(int camNum, FrameSource* capture, Mat* frame,
                     mutex* mutexRequestNewFrame, bool* requestNewFrame) {
     while (true) {
         // if the flag requestNewFrame is false or locked by a mutex,
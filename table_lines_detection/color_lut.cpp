@@ -0,0 +1,169 @@
+#include "color_lut.h"
+
+#include <climits>
+
+using namespace cv;
+using namespace std;
+
+
+/**
+    Compile the centroids of the k-mean into a lookup table, which gives the class of
+    each quantized color: the class of a pixel is then found with a single lookup,
+    instead of a search of the nearest centroid.
+    The class of each entry is the class of the color at the center of the entry, so the
+    pixels very close to the boundary between two classes may be in the other class
+
+    @param centroids The K centroids, given by the k-mean
+    @param lut The output lookup table (1 row, 2^(3*COLOR_LUT_BITS) columns, CV_8U),
+               indexed by B, G, R (from the most significant bits)
+*/
+void buildColorLut(const point* centroids, Mat& lut) {
+    const int nb_levels = 1 << COLOR_LUT_BITS;
+    const int shift = 8 - COLOR_LUT_BITS;
+    const int half_step = (1 << shift) / 2;
+    lut.create(1, nb_levels * nb_levels * nb_levels, CV_8U);
+    uchar* classes = lut.ptr<uchar>(0);
+
+    for (int b = 0; b < nb_levels; b++) {
+        for (int g = 0; g < nb_levels; g++) {
+            for (int r = 0; r < nb_levels; r++) {
+                int color_b = (b << shift) + half_step;
+                int color_g = (g << shift) + half_step;
+                int color_r = (r << shift) + half_step;
+
+                int dist_min = INT_MAX;
+                int candidate = 0;
+                for (int k = 0; k < K; k++) {
+                    int db = color_b - centroids[k].B;
+                    int dg = color_g - centroids[k].G;
+                    int dr = color_r - centroids[k].R;
+                    int dist = db*db + dg*dg + dr*dr;
+                    if (dist < dist_min) {
+                        dist_min = dist;
+                        candidate = k;
+                    }
+                }
+                classes[(b << (2*COLOR_LUT_BITS)) | (g << COLOR_LUT_BITS) | r] = (uchar)candidate;
+            }
+        }
+    }
+}
+
+
+// binarizes a stripe of rows with the lookup table
+class ApplyLutBody : public ParallelLoopBody {
+public:
+    ApplyLutBody(const Mat& src, const Mat& lut, int class_number, Mat& mask)
+        : src(src), lut(lut), class_number(class_number), mask(mask) {}
+
+    void operator()(const Range& range) const {
+        const int shift = 8 - COLOR_LUT_BITS;
+        const uchar* classes = lut.ptr<uchar>(0);
+
+        for (int i = range.start; i < range.end; i++) {
+            const Vec3b* row = src.ptr<Vec3b>(i);
+            uchar* mask_row = mask.ptr<uchar>(i);
+            for (int j = 0; j < src.cols; j++) {
+                int index = ((row[j][0] >> shift) << (2*COLOR_LUT_BITS))
+                          | ((row[j][1] >> shift) << COLOR_LUT_BITS)
+                          |  (row[j][2] >> shift);
+                mask_row[j] = (classes[index] == class_number) ? 255 : 0;
+            }
+        }
+    }
+
+private:
+    const Mat& src;
+    const Mat& lut;
+    int class_number;
+    Mat& mask;
+};
+
+/**
+    Binarize a picture with the lookup table: the pixels of the given class are set to white
+    (255), and all the other pixels are set to black (0)
+
+    @param src The picture (BGR), blurred like the picture used for the k-mean
+    @param lut The lookup table, given by buildColorLut or loadColorLut
+    @param class_number The class to keep (LINE_CLASS_NUMBER for the table lines)
+    @param mask The output binarized picture (CV_8U)
+*/
+void applyColorLut(const Mat& src, const Mat& lut, int class_number, Mat& mask) {
+    mask.create(src.size(), CV_8U);
+    parallel_for_(Range(0, src.rows), ApplyLutBody(src, lut, class_number, mask));
+}
+
+
+/**
+    Save the lookup table to a YAML or XML file, with the centroids it was built from
+
+    @param filename The output filename (.yml or .xml)
+    @param lut The lookup table
+    @param centroids The K centroids used to build the lookup table
+    @return false if the file could not be written
+*/
+bool saveColorLut(const string& filename, const Mat& lut, const point* centroids) {
+    FileStorage fs(filename, FileStorage::WRITE);
+    if (!fs.isOpened())
+        return false;
+
+    // one row for each centroid: B, G, R
+    Mat centroids_mat(K, 3, CV_32S);
+    for (int k = 0; k < K; k++) {
+        centroids_mat.at<int>(k, 0) = centroids[k].B;
+        centroids_mat.at<int>(k, 1) = centroids[k].G;
+        centroids_mat.at<int>(k, 2) = centroids[k].R;
+    }
+
+    fs << "Color_Lut_Bits" << COLOR_LUT_BITS;
+    fs << "Line_Class_Number" << LINE_CLASS_NUMBER;
+    fs << "Centroids" << centroids_mat;
+    fs << "Color_Lut" << lut;
+    return true;
+}
+
+/**
+    Load a lookup table written by saveColorLut
+
+    @param filename The YAML or XML filename
+    @param lut The output lookup table
+    @return false if the file could not be read, or if it was written with other parameters
+*/
+bool loadColorLut(const string& filename, Mat& lut) {
+    FileStorage fs(filename, FileStorage::READ);
+    if (!fs.isOpened())
+        return false;
+
+    int bits = 0, line_class_number = -1;
+    fs["Color_Lut_Bits"] >> bits;
+    fs["Line_Class_Number"] >> line_class_number;
+    fs["Color_Lut"] >> lut;
+
+    const int nb_levels = 1 << COLOR_LUT_BITS;
+    return bits == COLOR_LUT_BITS && line_class_number == LINE_CLASS_NUMBER
+        && lut.type() == CV_8U && (int)lut.total() == nb_levels * nb_levels * nb_levels;
+}
+
+
+LineMaskFilter::LineMaskFilter() {
+    opening_kernel = getStructuringElement(MORPH_ELLIPSE, Size(OPENING_KERNEL_LENGTH, OPENING_KERNEL_LENGTH));
+    closing_kernel = getStructuringElement(MORPH_ELLIPSE, Size(CLOSING_KERNEL_LENGTH, CLOSING_KERNEL_LENGTH));
+}
+
+/**
+    Clean the binarized picture of the table lines: the opening keeps only the big blobs
+    (like reflections on the table), which are removed from the picture, then a closing
+    makes the lines more straight
+
+    @param line_mask The binarized picture, given by applyColorLut
+    @param output The output binarized picture
+*/
+void LineMaskFilter::apply(const Mat& line_mask, Mat& output) {
+    morphologyEx(line_mask, opening, MORPH_OPEN, opening_kernel);
+
+    // the opening is included in the binarized picture, so the subtraction removes
+    // exactly the pixels of the big blobs
+    subtract(line_mask, opening, blobs_removed);
+
+    morphologyEx(blobs_removed, output, MORPH_CLOSE, closing_kernel);
+}
@@ -0,0 +1,43 @@
+#ifndef COLOR_LUT_H
+#define COLOR_LUT_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <string>
+
+#include "kmean.h"
+
+using namespace cv;
+using namespace std;
+
+// the size of the kernels used for the segmentation of the table lines
+const int BLUR_KERNEL_LENGTH = 15;  // must be an odd number
+const int OPENING_KERNEL_LENGTH = 15;  // must be an odd number
+const int CLOSING_KERNEL_LENGTH = 101;  // must be an odd number
+
+// number of bits kept for each color in the lookup table (32 x 32 x 32 entries)
+const int COLOR_LUT_BITS = 5;
+
+
+void buildColorLut(const point* centroids, Mat& lut);
+void applyColorLut(const Mat& src, const Mat& lut, int class_number, Mat& mask);
+bool saveColorLut(const string& filename, const Mat& lut, const point* centroids);
+bool loadColorLut(const string& filename, Mat& lut);
+
+// the morphological operations applied to the binarized picture of the table lines
+// (opening, removal of the big blobs, closing), with the kernels and the intermediate
+// pictures kept from one picture to the next. The operations are not fused by tiles:
+// the closing kernel is so large that each tile would need a margin of about
+// OPENING_KERNEL_LENGTH + CLOSING_KERNEL_LENGTH rows, computed again by its neighbours
+class LineMaskFilter {
+public:
+    LineMaskFilter();
+    void apply(const Mat& line_mask, Mat& output);
+
+private:
+    Mat opening_kernel, closing_kernel;
+    Mat opening, blobs_removed;
+};
+
+
+#endif
@@ -0,0 +1,265 @@
+#include "component_tree.h"
+
+using namespace cv;
+using namespace std;
+
+
+// root of the set of a pixel in the union-find forest, with path compression
+static int findRoot(vector<int>& zpar, int p) {
+    int root = p;
+    while (zpar[root] != root)
+        root = zpar[root];
+    while (zpar[p] != root) {
+        int next = zpar[p];
+        zpar[p] = root;
+        p = next;
+    }
+    return root;
+}
+
+/**
+    Build the component tree of a picture: the pixels are sorted by decreasing value
+    (counting sort), and merged with their neighbours already seen with a union-find,
+    so the picture is read only once, whatever the number of levels
+
+    @param gray The picture (CV_8U)
+*/
+void ComponentTree::build(const Mat& gray) {
+    CV_Assert(gray.type() == CV_8U);
+    image_size = gray.size();
+    int width = gray.cols, height = gray.rows;
+    int nb_pixels = width * height;
+
+    Mat image = gray.isContinuous() ? gray : gray.clone();
+    const uchar* values = image.ptr<uchar>(0);
+
+    // counting sort of the pixels by decreasing value
+    vector<int> histogram(256, 0);
+    for (int p = 0; p < nb_pixels; p++)
+        histogram[values[p]]++;
+    vector<int> start(256);
+    int position = 0;
+    for (int v = 255; v >= 0; v--) {
+        start[v] = position;
+        position += histogram[v];
+    }
+    vector<int> sorted(nb_pixels);
+    for (int p = 0; p < nb_pixels; p++)
+        sorted[start[values[p]]++] = p;
+
+    // union-find: each pixel is merged with its neighbours which have already been seen
+    // (which are greater or equal), and the root of each set becomes a child of the pixel
+    vector<int> parent(nb_pixels), zpar(nb_pixels, -1);
+    for (int i = 0; i < nb_pixels; i++) {
+        int p = sorted[i];
+        parent[p] = p;
+        zpar[p] = p;
+        int x = p % width, y = p / width;
+        for (int dy = -1; dy <= 1; dy++) {
+            int ny = y + dy;
+            if (ny < 0 || ny >= height)
+                continue;
+            for (int dx = -1; dx <= 1; dx++) {
+                int nx = x + dx;
+                if ((dx == 0 && dy == 0) || nx < 0 || nx >= width)
+                    continue;
+                int neighbour = ny * width + nx;
+                if (zpar[neighbour] < 0)
+                    continue;
+                int root = findRoot(zpar, neighbour);
+                if (root != p) {
+                    parent[root] = p;
+                    zpar[root] = p;
+                }
+            }
+        }
+    }
+
+    // from the root to the leaves: the parent of each pixel becomes the canonical pixel
+    // of its component (the one which has a parent with a lower value, or the root)
+    for (int i = nb_pixels - 1; i >= 0; i--) {
+        int p = sorted[i];
+        int q = parent[p];
+        if (values[parent[q]] == values[q])
+            parent[p] = parent[q];
+    }
+
+    // one node for each canonical pixel, in the order of the sort reversed (a parent
+    // before its children)
+    vector<int> node_of(nb_pixels, -1);
+    vector<int> node_pixel, node_parent;
+    for (int i = nb_pixels - 1; i >= 0; i--) {
+        int p = sorted[i];
+        if (parent[p] == p || values[parent[p]] != values[p]) {
+            node_of[p] = (int)node_pixel.size();
+            node_parent.push_back(parent[p] == p ? -1 : node_of[parent[p]]);
+            node_pixel.push_back(p);
+        }
+    }
+    for (int p = 0; p < nb_pixels; p++)
+        if (node_of[p] < 0)
+            node_of[p] = node_of[parent[p]];
+    int nb_nodes = (int)node_pixel.size();
+
+    // own pixels and bounding box of each node, then accumulated from the leaves to the root
+    vector<int> own_area(nb_nodes, 0);
+    vector<int> area(nb_nodes, 0);
+    vector<int> subtree_nodes(nb_nodes, 1);
+    vector<Vec4i> bounds(nb_nodes, Vec4i(width, height, -1, -1));  // x min, y min, x max, y max
+    for (int p = 0; p < nb_pixels; p++) {
+        int n = node_of[p];
+        int x = p % width, y = p / width;
+        own_area[n]++;
+        Vec4i& b = bounds[n];
+        b[0] = MIN(b[0], x); b[1] = MIN(b[1], y);
+        b[2] = MAX(b[2], x); b[3] = MAX(b[3], y);
+    }
+    for (int n = nb_nodes - 1; n >= 0; n--) {
+        area[n] += own_area[n];
+        int up = node_parent[n];
+        if (up < 0)
+            continue;
+        area[up] += area[n];
+        subtree_nodes[up] += subtree_nodes[n];
+        Vec4i& b = bounds[up];
+        b[0] = MIN(b[0], bounds[n][0]); b[1] = MIN(b[1], bounds[n][1]);
+        b[2] = MAX(b[2], bounds[n][2]); b[3] = MAX(b[3], bounds[n][3]);
+    }
+
+    // children of each node, stored contiguously
+    vector<int> first_child(nb_nodes + 1, 0), children(nb_nodes);
+    for (int n = 0; n < nb_nodes; n++)
+        if (node_parent[n] >= 0)
+            first_child[node_parent[n] + 1]++;
+    for (int n = 0; n < nb_nodes; n++)
+        first_child[n + 1] += first_child[n];
+    vector<int> next_child(first_child.begin(), first_child.end() - 1);
+    for (int n = 0; n < nb_nodes; n++)
+        if (node_parent[n] >= 0)
+            children[next_child[node_parent[n]]++] = n;
+
+    // depth-first traversal: each node gets its index in preorder, and the first index of
+    // its pixels (its own pixels, then the pixels of its children)
+    vector<int> preorder(nb_nodes), first_pixel(nb_nodes);
+    vector<int> stack;
+    int index = 0, pixel_index = 0;
+    for (int n = 0; n < nb_nodes; n++) {
+        if (node_parent[n] >= 0)
+            continue;
+        stack.push_back(n);
+        while (!stack.empty()) {
+            int current = stack.back();
+            stack.pop_back();
+            preorder[current] = index++;
+            first_pixel[current] = pixel_index;
+            pixel_index += own_area[current];
+            for (int c = first_child[current + 1] - 1; c >= first_child[current]; c--)
+                stack.push_back(children[c]);
+        }
+    }
+
+    nodes.resize(nb_nodes);
+    for (int n = 0; n < nb_nodes; n++) {
+        component_node& node = nodes[preorder[n]];
+        node.level = values[node_pixel[n]];
+        node.parent = node_parent[n] < 0 ? -1 : preorder[node_parent[n]];
+        node.area = area[n];
+        node.first_pixel = first_pixel[n];
+        node.nb_nodes = subtree_nodes[n];
+        node.bbox = Rect(bounds[n][0], bounds[n][1], bounds[n][2] - bounds[n][0] + 1, bounds[n][3] - bounds[n][1] + 1);
+    }
+
+    pixels.resize(nb_pixels);
+    for (int p = 0; p < nb_pixels; p++)
+        pixels[first_pixel[node_of[p]]++] = p;
+
+    contours.assign(nb_nodes, vector<Point>());
+    hulls.assign(nb_nodes, vector<Point>());
+    contour_computed.assign(nb_nodes, 0);
+    hull_computed.assign(nb_nodes, 0);
+}
+
+/**
+    The connected components of the pixels greater than a threshold, like the white
+    areas of threshold(..., THRESH_BINARY): the nodes above the threshold whose parent
+    is not. The subtree of a selected node is skipped, so only the nodes at or under the
+    threshold and the result are read
+
+    @param threshold The threshold (0 to 255)
+    @param result The output indices of the nodes
+    @param min_area The components with less pixels are not returned
+*/
+void ComponentTree::components(int threshold, vector<int>& result, int min_area) const {
+    result.clear();
+    int n = 0;
+    while (n < (int)nodes.size()) {
+        const component_node& node = nodes[n];
+        if (node.level > threshold) {
+            if (node.area >= min_area)
+                result.push_back(n);
+            n += node.nb_nodes;
+        }
+        else if (node.area < min_area) {
+            n += node.nb_nodes;  // its descendants are even smaller
+        }
+        else {
+            n++;
+        }
+    }
+}
+
+/**
+    The mask of a component, with a margin of one pixel around its bounding box
+    (the pixel (1, 1) of the mask is the top left corner of the bounding box)
+
+    @param n The index of the node
+    @param component_mask The output mask (CV_8U, 255 for the pixels of the component)
+*/
+void ComponentTree::mask(int n, Mat& component_mask) const {
+    const component_node& node = nodes[n];
+    component_mask = Mat::zeros(node.bbox.height + 2, node.bbox.width + 2, CV_8U);
+    int width = image_size.width;
+    for (int i = node.first_pixel; i < node.first_pixel + node.area; i++) {
+        int x = pixels[i] % width - node.bbox.x + 1;
+        int y = pixels[i] / width - node.bbox.y + 1;
+        component_mask.at<uchar>(y, x) = 255;
+    }
+}
+
+/**
+    The outer contour of a component, like the one given by findContours on the
+    thresholded picture, computed on the bounding box of the component only
+
+    @param n The index of the node
+    @return The contour
+*/
+const vector<Point>& ComponentTree::contour(int n) {
+    if (!contour_computed[n]) {
+        Mat component_mask;
+        mask(n, component_mask);
+        vector<vector<Point> > found;
+        findContours(component_mask, found, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE,
+                     Point(nodes[n].bbox.x - 1, nodes[n].bbox.y - 1));
+        // a component is connected, so it has a single outer contour
+        if (!found.empty())
+            contours[n].swap(found[0]);
+        contour_computed[n] = 1;
+    }
+    return contours[n];
+}
+
+/**
+    The convex hull of a component
+
+    @param n The index of the node
+    @return The vertices of the hull
+*/
+const vector<Point>& ComponentTree::hull(int n) {
+    if (!hull_computed[n]) {
+        const vector<Point>& points = contour(n);
+        if (!points.empty())
+            convexHull(points, hulls[n], false);
+        hull_computed[n] = 1;
+    }
+    return hulls[n];
+}
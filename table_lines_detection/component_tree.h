@@ -0,0 +1,53 @@
+#ifndef COMPONENT_TREE_H
+#define COMPONENT_TREE_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+// a node of the component tree: a connected component (8-connectivity) of the pixels
+// greater than or equal to its level, which is not the same set of pixels at the level above
+typedef struct {
+    int level;        // the lowest value of the pixels of the component
+    int parent;       // index of the parent node (-1 for the root): the component which contains this one
+    int area;         // number of pixels of the component (with the pixels of its descendants)
+    int first_pixel;  // index in the pixels of the tree of the first pixel of the component
+    int nb_nodes;     // number of nodes of the subtree (with this node)
+    Rect bbox;        // bounding box of the component
+} component_node;
+
+
+// the component tree (max-tree) of a grayscale picture: the connected components of the
+// picture thresholded at each level, built once. The nodes are stored in preorder, so the
+// nodes of a subtree are contiguous (indices n to n + nb_nodes - 1), and the pixels of a
+// component are also contiguous (first_pixel to first_pixel + area - 1)
+class ComponentTree {
+public:
+    void build(const Mat& gray);
+
+    int size() const { return (int)nodes.size(); }
+    const component_node& node(int n) const { return nodes[n]; }
+
+    void components(int threshold, vector<int>& result, int min_area = 0) const;
+    void mask(int n, Mat& component_mask) const;
+
+    // the outer contour and the convex hull of a component, computed at the first call
+    const vector<Point>& contour(int n);
+    const vector<Point>& hull(int n);
+
+private:
+    Size image_size;
+    vector<component_node> nodes;
+    vector<int> pixels;  // the index of the pixels (y * width + x), sorted by node in preorder
+
+    vector<vector<Point> > contours;
+    vector<vector<Point> > hulls;
+    vector<uchar> contour_computed;
+    vector<uchar> hull_computed;
+};
+
+
+#endif
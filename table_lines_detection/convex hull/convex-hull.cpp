@@ -10,6 +10,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "../component_tree.h"
+
 using namespace cv;
 using namespace std;
 
@@ -18,6 +20,10 @@ int thresh = 100;
 int max_thresh = 255;
 RNG rng(12345);
 
+// the components of the picture for all the thresholds, built once: moving the trackbar
+// only reads the tree, the picture is not thresholded again
+ComponentTree tree;
+
 /// Function header
 void thresh_callback(int, void* );
 
@@ -33,6 +39,12 @@ int main( int, char** argv )
     cvtColor( src, src_gray, COLOR_BGR2GRAY );
     blur( src_gray, src_gray, Size(3,3) );
 
+    /// Build the component tree
+    int64 start = getTickCount();
+    tree.build( src_gray );
+    cout << "component tree: " << tree.size() << " nodes, built in "
+         << (getTickCount() - start) * 1000.0 / getTickFrequency() << " ms" << endl;
+
     /// Create Window
     const char* source_window = "Source";
     namedWindow( source_window, WINDOW_AUTOSIZE );
@@ -50,24 +62,27 @@ int main( int, char** argv )
  */
 void thresh_callback(int, void* )
 {
-    Mat src_copy = src.clone();
-    Mat threshold_output;
-    vector<vector<Point> > contours;
-    vector<Vec4i> hierarchy;
+    int64 start = getTickCount();
 
-    /// Detect edges using Threshold
-    threshold( src_gray, threshold_output, thresh, 255, THRESH_BINARY );
+    /// Find the components above the threshold, like the white areas of
+    /// threshold( src_gray, threshold_output, thresh, 255, THRESH_BINARY )
+    vector<int> components;
+    tree.components( thresh, components );
 
-    /// Find contours
-    findContours( threshold_output, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, Point(0, 0) );
-
-    /// Find the convex hull object for each contour
-    vector<vector<Point> >hull( contours.size() );
-    for( size_t i = 0; i < contours.size(); i++ )
-        convexHull( Mat(contours[i]), hull[i], false );
+    /// Find the outer contour and the convex hull of each component
+    /// (computed on the bounding box of the component, and kept for the next calls)
+    vector<vector<Point> > contours( components.size() );
+    vector<vector<Point> > hull( components.size() );
+    for( size_t i = 0; i < components.size(); i++ )
+    {
+        contours[i] = tree.contour( components[i] );
+        hull[i] = tree.hull( components[i] );
+    }
+    cout << "threshold " << thresh << ": " << components.size() << " components in "
+         << (getTickCount() - start) * 1000.0 / getTickFrequency() << " ms" << endl;
 
     /// Draw contours + hull results
-    Mat drawing = Mat::zeros( threshold_output.size(), CV_8UC3 );
+    Mat drawing = Mat::zeros( src_gray.size(), CV_8UC3 );
     for( size_t i = 0; i< contours.size(); i++ )
     {
         Scalar color = Scalar( rng.uniform(0, 255), rng.uniform(0,255), rng.uniform(0,255) );
@@ -7,8 +7,8 @@
 
 #include <iostream>
 #include <vector>
-#include <math.h>
-#include <string.h>
+
+#include "square_detection.h"
 
 using namespace cv;
 using namespace std;
@@ -26,114 +26,13 @@ static void help()
 }
 
 
-int thresh = 50, N = 11;
 const char* window_name = "Square Detection Demo";
 
-// helper function:
-// finds a cosine of angle between vectors
-// pt0->pt1 and pt0->pt2
-static double angle( Point pt1, Point pt2, Point pt0 )
-{
-    double dx1 = pt1.x - pt0.x;
-    double dy1 = pt1.y - pt0.y;
-    double dx2 = pt2.x - pt0.x;
-    double dy2 = pt2.y - pt0.y;
-    return (dx1*dx2 + dy1*dy2)/sqrt((dx1*dx1 + dy1*dy1)*(dx2*dx2 + dy2*dy2) + 1e-10);
-}
-
-// returns sequence of squares detected on the image.
-// the sequence is stored in the specified memory storage
-static void findSquares( const Mat& image, vector<vector<Point> >& squares )
-{
-    squares.clear();
-
-    Mat pyr, timg, gray0(image.size(), CV_8U), gray;
-
-    // down-scale and upscale the image to filter out the noise
-    pyrDown(image, pyr, Size(image.cols/2, image.rows/2));
-    pyrUp(pyr, timg, image.size());
-    vector<vector<Point> > contours;
-
-    // find squares in every color plane of the image
-    for( int c = 0; c < 3; c++ )
-    {
-        int ch[] = {c, 0};
-        mixChannels(&timg, 1, &gray0, 1, ch, 1);
-
-        // try several threshold levels
-        for( int l = 0; l < N; l++ )
-        {
-            // hack: use Canny instead of zero threshold level.
-            // Canny helps to catch squares with gradient shading
-            if( l == 0 )
-            {
-                // apply Canny. Take the upper threshold from slider
-                // and set the lower to 0 (which forces edges merging)
-                Canny(gray0, gray, 0, thresh, 5);
-                // dilate canny output to remove potential
-                // holes between edge segments
-                dilate(gray, gray, Mat(), Point(-1,-1));
-            }
-            else
-            {
-                // apply threshold if l!=0:
-                //     tgray(x,y) = gray(x,y) < (l+1)*255/N ? 255 : 0
-                gray = gray0 >= (l+1)*255/N;
-            }
-
-            // find contours and store them all as a list
-            findContours(gray, contours, CV_RETR_LIST, CV_CHAIN_APPROX_SIMPLE);
-
-            vector<Point> approx;
-
-            // test each contour
-            for( size_t i = 0; i < contours.size(); i++ )
-            {
-                // approximate contour with accuracy proportional
-                // to the contour perimeter
-                approxPolyDP(Mat(contours[i]), approx, arcLength(Mat(contours[i]), true)*0.02, true);
-
-                // square contours should have 4 vertices after approximation
-                // relatively large area (to filter out noisy contours)
-                // and be convex.
-                // Note: absolute value of an area is used because
-                // area may be positive or negative - in accordance with the
-                // contour orientation
-                if( approx.size() == 4 &&
-                    fabs(contourArea(Mat(approx))) > 1000 &&
-                    isContourConvex(Mat(approx)) )
-                {
-                    double maxCosine = 0;
-
-                    for( int j = 2; j < 5; j++ )
-                    {
-                        // find the maximum cosine of the angle between joint edges
-                        double cosine = fabs(angle(approx[j%4], approx[j-2], approx[j-1]));
-                        maxCosine = MAX(maxCosine, cosine);
-                    }
-
-                    // if cosines of all angles are small
-                    // (all angles are ~90 degree) then write quandrange
-                    // vertices to resultant sequence
-                    if( maxCosine < 0.3 )
-                        squares.push_back(approx);
-                }
-            }
-        }
-    }
-}
-
-
-// the function draws all the squares in the image
-static void drawSquares( Mat& image, const vector<vector<Point> >& squares )
-{
-    for( size_t i = 0; i < squares.size(); i++ )
-    {
-        const Point* p = &squares[i][0];
-        int n = (int)squares[i].size();
-        polylines(image, &p, &n, 1, true, Scalar(0,255,0), 3, CV_AA);
-    }
-}
+// to stop the search as soon as a square looking like the table is found, define "SQUARES_EARLY_EXIT"
+// #define SQUARES_EARLY_EXIT
+const double TABLE_ASPECT_RATIO = 274 / 152.5;  // length / width of the table
+const double TABLE_ASPECT_TOLERANCE = 0.6;       // the perspective changes the aspect ratio
+const double TABLE_MIN_AREA_RATIO = 0.1;         // minimum area of the table / area of the image
 
 
 int main(int argc, char** argv)
@@ -161,7 +60,20 @@ int main(int argc, char** argv)
             continue;
         }
 
-        findSquares(image, squares);
+        int64 start = getTickCount();
+        #ifdef SQUARES_EARLY_EXIT
+            square_target target;
+            target.min_area = TABLE_MIN_AREA_RATIO * image.total();
+            target.max_area = image.total();
+            target.aspect_ratio = TABLE_ASPECT_RATIO;
+            target.aspect_tolerance = TABLE_ASPECT_TOLERANCE;
+            findSquares(image, squares, &target);
+        #else
+            findSquares(image, squares);
+        #endif
+        cout << filenames.at(i) << ": " << squares.size() << " squares found in "
+             << (getTickCount() - start) * 1000.0 / getTickFrequency() << " ms" << endl;
+
         drawSquares(image, squares);
         imshow(window_name, image);
 
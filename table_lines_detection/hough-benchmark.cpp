@@ -0,0 +1,241 @@
+#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <iostream>
+
+#include "hough_bands.h"
+#include "line_geometry.h"
+#include "table_rectification.h"
+
+using namespace cv;
+using namespace std;
+
+// number of runs of each algorithm, we keep the mean time
+const int NB_RUNS = 10;
+const int NB_RUNS_CORNERS = 1000;  // the corners are much faster to compute
+const int NB_POINTS = 1000000;      // number of points of the trajectories converted to the table
+
+
+// returns the elapsed time in milliseconds since 'start' (given by getTickCount)
+static double elapsedMs(int64 start) {
+    return (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
+
+// the classification of the lines of the first version of hough-transform.cpp,
+// one line at a time with cartToPolar
+static void classifyReference(const vector<Vec4i>& lines, int rows, int cols, line_groups& groups) {
+    groups.horizontal_up.clear();
+    groups.horizontal_down.clear();
+    groups.vertical_left.clear();
+    groups.vertical_right.clear();
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        Vec4i line = lines[i];
+
+        std::vector<float> x;
+        x.push_back((float) (line[0] - line[2]));
+        std::vector<float> y;
+        y.push_back((float) (line[1] - line[3]));
+        std::vector<float> magnitude;
+        std::vector<float> angle;
+        cartToPolar(x, y, magnitude, angle, true);
+
+        if (((int)angle[0] % 180) < 5 || ((int)angle[0] % 180) > 175) {
+            if (line[1] < (rows/2) && line[3] < (rows/2))
+                groups.horizontal_up.push_back(line);
+            else if (line[1] > (rows/2) && line[3] > (rows/2))
+                groups.horizontal_down.push_back(line);
+        }
+
+        if (((int)angle[0] % 180) > 85 && ((int)angle[0] % 180) < 95) {
+            if (line[0] < (cols/2) && line[2] < (cols/2))
+                groups.vertical_left.push_back(line);
+            else if (line[0] > (cols/2) && line[2] > (cols/2))
+                groups.vertical_right.push_back(line);
+        }
+    }
+}
+
+// the probabilistic Hough transform and the classification of the first version of hough-transform.cpp
+static void houghProbabilistic(const Mat& canny, int rows, int cols, line_groups& groups) {
+    vector<Vec4i> lines;
+    HoughLinesP(canny, lines, 1, CV_PI/180, HOUGH_THRESHOLD, HOUGH_MIN_LINE_LENGTH, HOUGH_MAX_LINE_GAP);
+    classifyReference(lines, rows, cols, groups);
+}
+
+// the intersection of two lines, like intersection_point in the first version of hough-transform.cpp
+static bool intersectionPoint(Point2f ori1, Point2f end1, Point2f ori2, Point2f end2, Point2f &res)
+{
+    Point2f x    = ori2 - ori1;
+    Point2f dir1 = end1 - ori1;
+    Point2f dir2 = end2 - ori2;
+
+    float cross = dir1.x*dir2.y - dir1.y*dir2.x;
+    if (abs(cross) < 1e-8)
+        return false;
+
+    double t1 = (x.x * dir2.y - x.y * dir2.x) / cross;
+    res = ori1 + dir1 * t1;
+    return true;
+}
+
+// the corner of the table given by two sets of lines, like the first version of hough-transform.cpp:
+// the intersections of all the pairs of lines, one at a time, then the farthest one with norm()
+static Point2f cornerReference(const vector<Vec4i>& lines1, const vector<Vec4i>& lines2, Point2f center) {
+    vector<Point2f> points;
+    for (size_t i = 0; i < lines1.size(); i++) {
+        for (size_t j = 0; j < lines2.size(); j++) {
+            Point2f ori1((float)(lines1[i][0]), (float)(lines1[i][1]));
+            Point2f end1((float)(lines1[i][2]), (float)(lines1[i][3]));
+            Point2f ori2((float)(lines2[j][0]), (float)(lines2[j][1]));
+            Point2f end2((float)(lines2[j][2]), (float)(lines2[j][3]));
+            Point2f res;
+            if (intersectionPoint(ori1, end1, ori2, end2, res) != false)
+                points.push_back(res);
+        }
+    }
+
+    Point2f corner;
+    if (points.size() > 0)
+        corner = points[0];
+    for (size_t i = 1; i < points.size(); i++)
+        if (norm(points[i] - center) > norm(corner - center))
+            corner = points[i];
+    return corner;
+}
+
+// the same corner with line_geometry.cpp
+static Point2f cornerSoa(const vector<Vec4i>& lines1, const vector<Vec4i>& lines2, Point2f center) {
+    segments_soa segments1, segments2;
+    points_soa points;
+    toSegments(lines1, segments1);
+    toSegments(lines2, segments2);
+    intersectSegments(segments1, segments2, points);
+
+    Point2f corner;
+    farthestPoint(points, center, corner);
+    return corner;
+}
+
+static void printGroups(const line_groups& groups) {
+    cout << "    horizontal upper lines: " << groups.horizontal_up.size()   << endl;
+    cout << "    horizontal lower lines: " << groups.horizontal_down.size() << endl;
+    cout << "    vertical left lines: "    << groups.vertical_left.size()   << endl;
+    cout << "    vertical right lines: "   << groups.vertical_right.size()  << endl;
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = argc >= 2 ? argv[1] : "table.jpg";
+
+    Mat src = imread(filename, CV_LOAD_IMAGE_GRAYSCALE);
+    if(src.empty())
+    {
+        cout << "can not open " << filename << endl;
+        return -1;
+    }
+    cout << "picture " << filename << ": " << src.cols << "x" << src.rows << ", "
+         << getNumThreads() << " threads, mean of " << NB_RUNS << " runs" << endl;
+
+    // the edge detection is the same for both algorithms
+    Mat canny;
+    int64 start = getTickCount();
+    for (int run = 0; run < NB_RUNS; run++)
+        Canny(src, canny, 50, 200, 3);
+    double time_canny = elapsedMs(start) / NB_RUNS;
+    cout << "Canny: " << time_canny << " ms" << endl;
+
+    line_groups groups_probabilistic, groups_bands;
+
+    start = getTickCount();
+    for (int run = 0; run < NB_RUNS; run++)
+        houghProbabilistic(canny, src.rows, src.cols, groups_probabilistic);
+    double time_probabilistic = elapsedMs(start) / NB_RUNS;
+    cout << endl << "probabilistic Hough transform and classification: " << time_probabilistic << " ms" << endl;
+    printGroups(groups_probabilistic);
+
+    start = getTickCount();
+    for (int run = 0; run < NB_RUNS; run++)
+        houghBands(canny, groups_bands);
+    double time_bands = elapsedMs(start) / NB_RUNS;
+    cout << endl << "Hough transform restricted to the angles of the table lines: " << time_bands << " ms" << endl;
+    printGroups(groups_bands);
+
+    cout << endl << "speedup: " << time_probabilistic / time_bands << "x (Hough only), "
+         << (time_canny + time_probabilistic) / (time_canny + time_bands) << "x (with Canny)" << endl;
+
+    // the corner solver: classification of the lines, intersections, and farthest point
+    // (for the left up corner), from the lines of the probabilistic Hough transform
+    vector<Vec4i> lines;
+    HoughLinesP(canny, lines, 1, CV_PI/180, HOUGH_THRESHOLD, HOUGH_MIN_LINE_LENGTH, HOUGH_MAX_LINE_GAP);
+    Point2f center(src.cols / 2, src.rows / 2);
+    Point2f corner_reference, corner_soa;
+    line_groups groups;
+
+    start = getTickCount();
+    for (int run = 0; run < NB_RUNS_CORNERS; run++) {
+        classifyReference(lines, src.rows, src.cols, groups);
+        corner_reference = cornerReference(groups.horizontal_up, groups.vertical_left, center);
+    }
+    double time_corner_reference = elapsedMs(start) * 1000 / NB_RUNS_CORNERS;
+
+    start = getTickCount();
+    for (int run = 0; run < NB_RUNS_CORNERS; run++) {
+        classifySegments(lines, src.size(), groups);
+        corner_soa = cornerSoa(groups.horizontal_up, groups.vertical_left, center);
+    }
+    double time_corner_soa = elapsedMs(start) * 1000 / NB_RUNS_CORNERS;
+
+    cout << endl << "corner solver for " << lines.size() << " lines, "
+         << groups.horizontal_up.size() << " x " << groups.vertical_left.size() << " intersections:" << endl
+         << "    one line at a time: " << time_corner_reference << " us, corner ("
+         << corner_reference.x << ", " << corner_reference.y << ")" << endl
+         << "    structure of arrays: " << time_corner_soa << " us, corner ("
+         << corner_soa.x << ", " << corner_soa.y << ")" << endl;
+
+    // conversion of the points of trajectories to the table coordinates: perspectiveTransform
+    // called for each point, called once for all the points, and the structure of arrays
+    Point2f corners[4] = { Point2f(src.cols * 0.2f, src.rows * 0.3f), Point2f(src.cols * 0.8f, src.rows * 0.3f),
+                           Point2f(src.cols * 0.9f, src.rows * 0.8f), Point2f(src.cols * 0.1f, src.rows * 0.8f) };
+    Mat homography;
+    tableHomography(corners, homography);
+
+    RNG rng(12345);
+    vector<Point2f> trajectory(NB_POINTS), trajectory_table;
+    points_soa trajectory_soa, trajectory_soa_table;
+    trajectory_soa.x.resize(NB_POINTS);
+    trajectory_soa.y.resize(NB_POINTS);
+    for (int i = 0; i < NB_POINTS; i++) {
+        trajectory[i] = Point2f(rng.uniform(0.f, (float)src.cols), rng.uniform(0.f, (float)src.rows));
+        trajectory_soa.x[i] = trajectory[i].x;
+        trajectory_soa.y[i] = trajectory[i].y;
+    }
+
+    start = getTickCount();
+    vector<Point2f> one_point(1), one_point_table;
+    for (int i = 0; i < NB_POINTS; i++) {
+        one_point[0] = trajectory[i];
+        perspectiveTransform(one_point, one_point_table, homography);
+    }
+    double time_per_point = elapsedMs(start);
+
+    start = getTickCount();
+    perspectiveTransform(trajectory, trajectory_table, homography);
+    double time_batch = elapsedMs(start);
+
+    start = getTickCount();
+    transformPoints(homography, trajectory_soa, trajectory_soa_table);
+    double time_soa = elapsedMs(start);
+
+    float error_max = 0;
+    for (int i = 0; i < NB_POINTS; i++)
+        error_max = MAX(error_max, (float)norm(trajectory_table[i] - Point2f(trajectory_soa_table.x[i], trajectory_soa_table.y[i])));
+
+    cout << endl << "conversion of " << NB_POINTS << " points to the table coordinates:" << endl
+         << "    perspectiveTransform for each point: " << time_per_point << " ms" << endl
+         << "    perspectiveTransform for all the points: " << time_batch << " ms" << endl
+         << "    structure of arrays: " << time_soa << " ms (maximum difference "
+         << error_max << " cm)" << endl;
+
+    return 0;
+}
@@ -4,6 +4,12 @@
 #include "opencv2/imgproc/imgproc.hpp"
 
 #include <iostream>
+#include <string.h>
+
+#include "color_lut.h"
+#include "hough_bands.h"
+#include "line_geometry.h"
+#include "table_rectification.h"
 
 using namespace cv;
 using namespace std;
@@ -11,20 +17,48 @@ using namespace std;
 // to use "basic" Hough transform instead of "probabilistic" one, define "HOUGH_BASIC"
 // #define HOUGH_BASIC
 
+// to use the Hough transform which votes only for the almost horizontal and almost vertical lines
+// (see hough_bands.cpp) instead of the probabilistic one, define "HOUGH_ANGLE_BANDS"
+// #define HOUGH_ANGLE_BANDS
+
 void help()
 {
  cout << "This program demonstrates line finding with the Hough transform.\n"
-         "Usage:  ./hough-transform <image_name>" << endl;
+         "Usage:  ./hough-transform <image_name> [<lookup_table>|-] [<table_corners>]\n"
+         "The lookup table is written by k-mean-custom or k-mean-video: if it is given,\n"
+         "the lines are searched in the binarized picture of the table lines.\n"
+         "If a table corners filename is given, the corners are written to that file (YAML)" << endl;
 }
 
-bool intersection_point(Point2f ori1, Point2f end1, Point2f ori2, Point2f end2, Point2f &res);
-
 int main(int argc, char** argv)
 {
     const char* filename = argc >= 2 ? argv[1] : "table.jpg";
     const char* window_name = "table line detection";
 
-    Mat src = imread(filename, CV_LOAD_IMAGE_GRAYSCALE);
+    Mat src;
+    if (argc >= 3 && strcmp(argv[2], "-") != 0) {
+        // we binarize the picture with the lookup table of the k-mean classes:
+        // only the pixels of the table lines are kept
+        Mat lut;
+        if (!loadColorLut(argv[2], lut)) {
+            help();
+            cout << "can not read lookup table " << argv[2] << endl;
+            return -1;
+        }
+        Mat src_color = imread(filename, CV_LOAD_IMAGE_COLOR);
+        if(src_color.empty())
+        {
+            help();
+            cout << "can not open " << filename << endl;
+            return -1;
+        }
+        Mat line_mask;
+        GaussianBlur(src_color, src_color, Size(BLUR_KERNEL_LENGTH, BLUR_KERNEL_LENGTH), 0, 0);
+        applyColorLut(src_color, lut, LINE_CLASS_NUMBER, line_mask);
+        LineMaskFilter().apply(line_mask, src);
+    }
+    else
+        src = imread(filename, CV_LOAD_IMAGE_GRAYSCALE);
     if(src.empty())
     {
         help();
@@ -58,6 +92,23 @@ int main(int argc, char** argv)
             pt2.y = cvRound(y0 - 1000*(a));
             line(dst_color, pt1, pt2, Scalar(0,0,255), 3, CV_AA);
         }
+    // Hough transform restricted to the angles of the table lines
+    #elif defined(HOUGH_ANGLE_BANDS)
+        // the segments are already sorted in the four sets of table lines
+        line_groups groups;
+        houghBands(canny, groups);
+
+        lines.insert(lines.end(), groups.horizontal_up.begin(), groups.horizontal_up.end());
+        lines.insert(lines.end(), groups.horizontal_down.begin(), groups.horizontal_down.end());
+        lines.insert(lines.end(), groups.vertical_left.begin(), groups.vertical_left.end());
+        lines.insert(lines.end(), groups.vertical_right.begin(), groups.vertical_right.end());
+
+        for( size_t i = 0; i < lines.size(); i++ )
+        {
+            Vec4i l = lines[i];
+            line(dst_color, Point(l[0], l[1]), Point(l[2], l[3]), Scalar(0,0,255), 2, CV_AA);
+        }
+        cout << "Number of lines found: " << lines.size() << endl;
     // Probabilistic Hough transform
     #else
         // we apply Hough transform to the image, after canny edge detection, to get all lines
@@ -85,130 +136,44 @@ int main(int argc, char** argv)
 
     // we separate the lines found with Probabilistic Hough Transform
     // in four sets, based on the coordinates of the end of the lines,
-    // and the line angle
-    vector<Vec4i> lines_horizontal_up;
-    vector<Vec4i> lines_horizontal_down;
-    vector<Vec4i> lines_vertical_left;
-    vector<Vec4i> lines_vertical_right;
-    
-    for (size_t i = 0; i < lines.size(); i++) {
-        Vec4i line = lines[i];
-
-        // we convert get the angle of the line, to know
-        // if it's vertical or horizontal
-
-        // input for cartToPolar
-        std::vector<float> x;
-        x.push_back((float) (line[0] - line[2]));
-        std::vector<float> y;
-        y.push_back((float) (line[1] - line[3]));
-        // output from cartToPolar
-        std::vector<float> magnitude;
-        std::vector<float> angle;
-
-        cartToPolar(x, y, magnitude, angle, true);
-
-        // check if it's a horizontal line
-        if (((int)angle[0] % 180) < 5 || ((int)angle[0] % 180) > 175) {
-            // check if it's the upper line or the lower line
-            // we use the coordinates of the ends of the line
-            // WARNING: OpenCV y axis is growing when going down
-            if (line[1] < (src.rows/2) && line[3] < (src.rows/2))
-                lines_horizontal_up.push_back(line);
-            else if (line[1] > (src.rows/2) && line[3] > (src.rows/2))
-                lines_horizontal_down.push_back(line);
-        }
-
-        // check if it's a vertical line
-        if (((int)angle[0] % 180) > 85 && ((int)angle[0] % 180) < 95) {
-            if (line[0] < (src.cols/2) && line[2] < (src.cols/2))
-                lines_vertical_left.push_back(line);
-            else if (line[0] > (src.cols/2) && line[2] > (src.cols/2))
-                lines_vertical_right.push_back(line);
-        }
-    }
+    // and the line angle (all the lines at once, see line_geometry.cpp)
+    #ifndef HOUGH_ANGLE_BANDS
+        line_groups groups;
+        classifySegments(lines, src.size(), groups);
+    #endif
 
-    cout << "horizontal upper lines: " << lines_horizontal_up.size()   << endl;
-    cout << "horizontal lower lines: " << lines_horizontal_down.size() << endl;
-    cout << "vertical left lines: "    << lines_vertical_left.size()   << endl;
-    cout << "vertical right lines: "   << lines_vertical_right.size()  << endl;
+    cout << "horizontal upper lines: " << groups.horizontal_up.size()   << endl;
+    cout << "horizontal lower lines: " << groups.horizontal_down.size() << endl;
+    cout << "vertical left lines: "    << groups.vertical_left.size()   << endl;
+    cout << "vertical right lines: "   << groups.vertical_right.size()  << endl;
 
     // we find the points at the intersections of the lines, at each corner
-    vector<Point2f> points_left_up_corner;
-    vector<Point2f> points_right_up_corner;
-    vector<Point2f> points_right_down_corner;
-    vector<Point2f> points_left_down_corner;
-
-    // left up corner:
-    for (size_t i = 0; i < lines_horizontal_up.size(); i++) {
-        for (size_t j = 0; j < lines_vertical_left.size(); j++) {
-            Point2f ori1((float)(lines_horizontal_up[i][0]), (float)(lines_horizontal_up[i][1]));
-            Point2f end1((float)(lines_horizontal_up[i][2]), (float)(lines_horizontal_up[i][3]));
-            Point2f ori2((float)(lines_vertical_left[j][0]), (float)(lines_vertical_left[j][1]));
-            Point2f end2((float)(lines_vertical_left[j][2]), (float)(lines_vertical_left[j][3]));
-            Point2f res;
-
-            if (intersection_point(ori1, end1, ori2, end2, res) != false)
-                points_left_up_corner.push_back(res);
-        }
-    }
-
-    // right up corner:
-    for (size_t i = 0; i < lines_horizontal_up.size(); i++) {
-        for (size_t j = 0; j < lines_vertical_right.size(); j++) {
-            Point2f ori1((float)(lines_horizontal_up[i][0]), (float)(lines_horizontal_up[i][1]));
-            Point2f end1((float)(lines_horizontal_up[i][2]), (float)(lines_horizontal_up[i][3]));
-            Point2f ori2((float)(lines_vertical_right[j][0]), (float)(lines_vertical_right[j][1]));
-            Point2f end2((float)(lines_vertical_right[j][2]), (float)(lines_vertical_right[j][3]));
-            Point2f res;
-
-            if (intersection_point(ori1, end1, ori2, end2, res) != false)
-                points_right_up_corner.push_back(res);
-        }
-    }
-
-    // right down corner:
-    for (size_t i = 0; i < lines_horizontal_down.size(); i++) {
-        for (size_t j = 0; j < lines_vertical_right.size(); j++) {
-            Point2f ori1((float)(lines_horizontal_down[i][0]), (float)(lines_horizontal_down[i][1]));
-            Point2f end1((float)(lines_horizontal_down[i][2]), (float)(lines_horizontal_down[i][3]));
-            Point2f ori2((float)(lines_vertical_right[j][0]), (float)(lines_vertical_right[j][1]));
-            Point2f end2((float)(lines_vertical_right[j][2]), (float)(lines_vertical_right[j][3]));
-            Point2f res;
-
-            if (intersection_point(ori1, end1, ori2, end2, res) != false)
-                points_right_down_corner.push_back(res);
-        }
-    }
-
-    // left down corner:
-    for (size_t i = 0; i < lines_horizontal_down.size(); i++) {
-        for (size_t j = 0; j < lines_vertical_left.size(); j++) {
-            Point2f ori1((float)(lines_horizontal_down[i][0]), (float)(lines_horizontal_down[i][1]));
-            Point2f end1((float)(lines_horizontal_down[i][2]), (float)(lines_horizontal_down[i][3]));
-            Point2f ori2((float)(lines_vertical_left[j][0]), (float)(lines_vertical_left[j][1]));
-            Point2f end2((float)(lines_vertical_left[j][2]), (float)(lines_vertical_left[j][3]));
-            Point2f res;
-
-            if (intersection_point(ori1, end1, ori2, end2, res) != false)
-                points_left_down_corner.push_back(res);
-        }
-    }
-
-    cout << "left up corner points: "    << points_left_up_corner.size()    << endl;
-    cout << "right up corner points: "   << points_right_up_corner.size()   << endl;
-    cout << "right down corner points: " << points_right_down_corner.size() << endl;
-    cout << "left down corner points: "  << points_left_down_corner.size()  << endl;
+    segments_soa lines_horizontal_up, lines_horizontal_down, lines_vertical_left, lines_vertical_right;
+    toSegments(groups.horizontal_up,   lines_horizontal_up);
+    toSegments(groups.horizontal_down, lines_horizontal_down);
+    toSegments(groups.vertical_left,   lines_vertical_left);
+    toSegments(groups.vertical_right,  lines_vertical_right);
+
+    points_soa points_left_up_corner;
+    points_soa points_right_up_corner;
+    points_soa points_right_down_corner;
+    points_soa points_left_down_corner;
+    intersectSegments(lines_horizontal_up,   lines_vertical_left,  points_left_up_corner);
+    intersectSegments(lines_horizontal_up,   lines_vertical_right, points_right_up_corner);
+    intersectSegments(lines_horizontal_down, lines_vertical_right, points_right_down_corner);
+    intersectSegments(lines_horizontal_down, lines_vertical_left,  points_left_down_corner);
+
+    cout << "left up corner points: "    << points_left_up_corner.x.size()    << endl;
+    cout << "right up corner points: "   << points_right_up_corner.x.size()   << endl;
+    cout << "right down corner points: " << points_right_down_corner.x.size() << endl;
+    cout << "left down corner points: "  << points_left_down_corner.x.size()  << endl;
 
     // we draw all the points on the picture
-    for (size_t i = 0; i < points_left_up_corner.size(); i++)
-        circle(dst_color, points_left_up_corner[i], 2, Scalar(255,0,0), 2);
-    for (size_t i = 0; i < points_right_up_corner.size(); i++)
-        circle(dst_color, points_right_up_corner[i], 2, Scalar(255,0,0), 2);
-    for (size_t i = 0; i < points_right_down_corner.size(); i++)
-        circle(dst_color, points_right_down_corner[i], 2, Scalar(255,0,0), 2);
-    for (size_t i = 0; i < points_left_down_corner.size(); i++)
-        circle(dst_color, points_left_down_corner[i], 2, Scalar(255,0,0), 2);
+    const points_soa* corner_points[4] = { &points_left_up_corner, &points_right_up_corner,
+                                           &points_right_down_corner, &points_left_down_corner };
+    for (int c = 0; c < 4; c++)
+        for (size_t i = 0; i < corner_points[c]->x.size(); i++)
+            circle(dst_color, Point2f(corner_points[c]->x[i], corner_points[c]->y[i]), 2, Scalar(255,0,0), 2);
     
     imshow(window_name, dst_color);
     waitKey();
@@ -228,37 +193,36 @@ int main(int argc, char** argv)
 
     Point2f table_center(src.cols / 2, src.rows / 2);
 
-    // left up corner
-    Point2f left_up_corner;
-    if (points_left_up_corner.size() > 0)
-        left_up_corner = points_left_up_corner[0];
-    for (size_t i = 1; i < points_left_up_corner.size(); i++)
-        if (norm(points_left_up_corner[i] - table_center) > norm(left_up_corner - table_center))
-            left_up_corner = points_left_up_corner[i];
-
-    // right up corner
-    Point2f right_up_corner;
-    if (points_right_up_corner.size() > 0)
-        right_up_corner = points_right_up_corner[0];
-    for (size_t i = 1; i < points_right_up_corner.size(); i++)
-        if (norm(points_right_up_corner[i] - table_center) > norm(right_up_corner - table_center))
-            right_up_corner = points_right_up_corner[i];
-
-    // right down corner
-    Point2f right_down_corner;
-    if (points_right_down_corner.size() > 0)
-        right_down_corner = points_right_down_corner[0];
-    for (size_t i = 1; i < points_right_down_corner.size(); i++)
-        if (norm(points_right_down_corner[i] - table_center) > norm(right_down_corner - table_center))
-            right_down_corner = points_right_down_corner[i];
-
-    // left down corner
-    Point2f left_down_corner;
-    if (points_left_down_corner.size() > 0)
-        left_down_corner = points_left_down_corner[0];
-    for (size_t i = 1; i < points_left_down_corner.size(); i++)
-        if (norm(points_left_down_corner[i] - table_center) > norm(left_down_corner - table_center))
-            left_down_corner = points_left_down_corner[i];
+    // if a group of points is empty, a corner is missing: we stop there rather than
+    // writing a wrong table for the ball tracking
+    Point2f left_up_corner, right_up_corner, right_down_corner, left_down_corner;
+    bool found = farthestPoint(points_left_up_corner,    table_center, left_up_corner);
+    found = farthestPoint(points_right_up_corner,   table_center, right_up_corner)   && found;
+    found = farthestPoint(points_right_down_corner, table_center, right_down_corner) && found;
+    found = farthestPoint(points_left_down_corner,  table_center, left_down_corner)  && found;
+    if (!found) {
+        cout << "can not find the 4 corners of the table" << endl;
+        return -1;
+    }
+
+    // we print the bounding box of the table, which can be given to the distortion correction
+    // program so that it undistorts only the region of the table
+    vector<Point2f> table_corners;
+    table_corners.push_back(left_up_corner);
+    table_corners.push_back(right_up_corner);
+    table_corners.push_back(right_down_corner);
+    table_corners.push_back(left_down_corner);
+    Rect table_bounding_box = boundingRect(table_corners);
+    cout << "table bounding box (x y width height): " << table_bounding_box.x << " " << table_bounding_box.y
+         << " " << table_bounding_box.width << " " << table_bounding_box.height << endl;
+
+    // the corners can also be written to a file, for the ball tracking
+    if (argc >= 4) {
+        if (saveTableCorners(argv[3], table_corners, src.size()))
+            cout << "table corners written to " << argv[3] << endl;
+        else
+            cout << "can not write " << argv[3] << endl;
+    }
 
     // we draw the four corners, and the lines between them
     cvtColor(src, src, CV_GRAY2BGR);
@@ -271,6 +235,17 @@ int main(int argc, char** argv)
     circle(src, right_down_corner, 2, Scalar(255,0,0), 2);
     circle(src, left_down_corner, 2, Scalar(255,0,0), 2);
 
+    // we display the view of the table from above: the homography of the table is
+    // baked into remap tables, which would be computed once for a fixed camera
+    Mat picture = imread(filename, CV_LOAD_IMAGE_COLOR);
+    if (!picture.empty()) {
+        Mat homography, map1, map2, rectified;
+        tableHomography(&table_corners[0], homography);
+        initRectificationMaps(homography, map1, map2);
+        rectifyTable(picture, map1, map2, rectified);
+        imshow("table seen from above", rectified);
+    }
+
     // we display the final result
     imshow(window_name, src);
     waitKey();
@@ -278,22 +253,3 @@ int main(int argc, char** argv)
     return 0;
 }
 
-
-// Finds the intersection of two lines, or returns false.
-// Each line is defined by two points, (ori1, end1) for the first line
-// and (ori2, end2) for the second line
-bool intersection_point(Point2f ori1, Point2f end1, Point2f ori2, Point2f end2, Point2f &res)
-{
-    Point2f x    = ori2 - ori1;  // vector from ori1 to ori2
-    Point2f dir1 = end1 - ori1;  // direction vector of line 1
-    Point2f dir2 = end2 - ori2;  // direction vector of line 2
-
-    float cross = dir1.x*dir2.y - dir1.y*dir2.x;  // cross product
-    if (abs(cross) < /*EPS*/1e-8)  // if the two lines are parallel
-        return false;
-
-    double t1 = (x.x * dir2.y - x.y * dir2.x) / cross;
-    res = ori1 + dir1 * t1;
-    return true;
-}
-
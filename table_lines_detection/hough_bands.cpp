@@ -0,0 +1,244 @@
+#include "hough_bands.h"
+
+#include <math.h>
+#include <mutex>
+
+using namespace cv;
+using namespace std;
+
+
+// the angles (of the normal of the lines) for which we vote:
+// the normal of a horizontal line is vertical (90 degrees),
+// and the normal of a vertical line is horizontal (0 or 180 degrees)
+typedef struct {
+    vector<float> cos_theta;
+    vector<float> sin_theta;
+    vector<bool> horizontal;  // whether the lines of that angle are horizontal
+} hough_angles;
+
+static void bandAngles(hough_angles& angles) {
+    for (int degrees = 0; degrees < 180; degrees++) {
+        bool horizontal = abs(degrees - 90) <= HOUGH_BAND_DEGREES;
+        bool vertical = degrees <= HOUGH_BAND_DEGREES || degrees >= 180 - HOUGH_BAND_DEGREES;
+        if (!horizontal && !vertical)
+            continue;
+        double theta = degrees * CV_PI / 180;
+        angles.cos_theta.push_back((float)cos(theta));
+        angles.sin_theta.push_back((float)sin(theta));
+        angles.horizontal.push_back(horizontal);
+    }
+}
+
+
+// votes of a group of edge points, added to the accumulator at the end
+class VoteBody : public ParallelLoopBody {
+public:
+    VoteBody(const vector<Point>& points, const hough_angles& angles, int rho_offset,
+             Mat& accumulator, mutex* accumulator_mutex)
+        : points(points), angles(angles), rho_offset(rho_offset),
+          accumulator(accumulator), accumulator_mutex(accumulator_mutex) {}
+
+    void operator()(const Range& range) const {
+        // each stripe has its own accumulator: one row per angle, one column per distance
+        Mat stripe_accumulator = Mat::zeros(accumulator.size(), CV_32S);
+        int nb_angles = (int)angles.cos_theta.size();
+
+        for (int i = range.start; i < range.end; i++) {
+            float x = (float)points[i].x, y = (float)points[i].y;
+            for (int a = 0; a < nb_angles; a++) {
+                int rho = cvRound(x * angles.cos_theta[a] + y * angles.sin_theta[a]);
+                stripe_accumulator.at<int>(a, rho + rho_offset)++;
+            }
+        }
+
+        lock_guard<mutex> lock(*accumulator_mutex);
+        accumulator += stripe_accumulator;
+    }
+
+private:
+    const vector<Point>& points;
+    const hough_angles& angles;
+    int rho_offset;
+    Mat& accumulator;
+    mutex* accumulator_mutex;
+};
+
+// whether there is an edge at (x,y), or next to it across the line
+static inline bool edgeNear(const Mat& edges, int x, int y, bool horizontal) {
+    for (int d = -1; d <= 1; d++) {
+        int xd = horizontal ? x : x + d;
+        int yd = horizontal ? y + d : y;
+        if (xd >= 0 && yd >= 0 && xd < edges.cols && yd < edges.rows && edges.at<uchar>(yd, xd) != 0)
+            return true;
+    }
+    return false;
+}
+
+// follows a line of the Hough space on the edges picture, and returns the segments
+// of that line that are long enough
+static void extractSegments(const Mat& edges, float rho, float cos_theta, float sin_theta,
+                            bool horizontal, vector<Vec4i>& segments) {
+    // we walk along the x axis for the horizontal lines, along the y axis for the vertical ones
+    // (the angle of the line is less than HOUGH_BAND_DEGREES, so the length along the axis
+    // is almost the length of the line)
+    int length = horizontal ? edges.cols : edges.rows;
+    int run_start = -1, run_end = -1, gap = 0;
+    Point start, end;
+
+    for (int t = 0; t <= length; t++) {
+        bool edge = false;
+        Point p;
+        if (t < length) {
+            if (horizontal)
+                p = Point(t, cvRound((rho - t * cos_theta) / sin_theta));
+            else
+                p = Point(cvRound((rho - t * sin_theta) / cos_theta), t);
+            edge = edgeNear(edges, p.x, p.y, horizontal);
+        }
+
+        if (edge) {
+            if (run_start < 0) {
+                run_start = t;
+                start = p;
+            }
+            run_end = t;
+            end = p;
+            gap = 0;
+        }
+        else if (run_start >= 0 && (++gap > HOUGH_MAX_LINE_GAP || t == length)) {
+            if (run_end - run_start >= HOUGH_MIN_LINE_LENGTH)
+                segments.push_back(Vec4i(start.x, start.y, end.x, end.y));
+            run_start = -1;
+            gap = 0;
+        }
+    }
+}
+
+// a local maximum of the accumulator
+typedef struct {
+    int angle;
+    int rho;
+} hough_peak;
+
+// extracts the segments of a group of peaks, each peak in its own output vector
+class SegmentsBody : public ParallelLoopBody {
+public:
+    SegmentsBody(const Mat& edges, const vector<hough_peak>& peaks, const hough_angles& angles,
+                 int rho_offset, vector<vector<Vec4i> >& segments)
+        : edges(edges), peaks(peaks), angles(angles), rho_offset(rho_offset), segments(segments) {}
+
+    void operator()(const Range& range) const {
+        for (int i = range.start; i < range.end; i++) {
+            int a = peaks[i].angle;
+            extractSegments(edges, (float)(peaks[i].rho - rho_offset), angles.cos_theta[a],
+                            angles.sin_theta[a], angles.horizontal[a], segments[i]);
+        }
+    }
+
+private:
+    const Mat& edges;
+    const vector<hough_peak>& peaks;
+    const hough_angles& angles;
+    int rho_offset;
+    vector<vector<Vec4i> >& segments;
+};
+
+/**
+    Hough transform specialized for the lines of the table: the edge points vote only for
+    the angles close to the horizontal and vertical directions, in parallel,
+    and the segments are returned already sorted in the four sets of table lines
+
+    @param edges The edges picture, given by Canny (CV_8U)
+    @param groups The output segments, in four sets (upper and lower horizontal lines,
+                  left and right vertical lines)
+*/
+void houghBands(const Mat& edges, line_groups& groups) {
+    hough_angles angles;
+    bandAngles(angles);
+    int nb_angles = (int)angles.cos_theta.size();
+
+    // the distance of the lines to the origin is between -width and width + height
+    int rho_offset = edges.cols;
+    Mat accumulator = Mat::zeros(nb_angles, 2 * edges.cols + edges.rows + 1, CV_32S);
+
+    // the edge points
+    vector<Point> points;
+    for (int i = 0; i < edges.rows; i++) {
+        const uchar* row = edges.ptr<uchar>(i);
+        for (int j = 0; j < edges.cols; j++)
+            if (row[j] != 0)
+                points.push_back(Point(j, i));
+    }
+
+    // one stripe per thread, because each stripe has its own accumulator
+    mutex accumulator_mutex;
+    parallel_for_(Range(0, (int)points.size()),
+                  VoteBody(points, angles, rho_offset, accumulator, &accumulator_mutex), getNumThreads());
+
+    // the peaks: the lines with enough votes, which have the most votes among their neighbours
+    // (angles of the same band +/- 1 degree, distances +/- 2 pixels)
+    // the band of the vertical lines goes across 0 / 180 degrees: the line of angle 179 degrees
+    // and distance rho is the line of angle -1 degree and distance -rho, so the first and the
+    // last angles are neighbours, with the opposite distance
+    vector<hough_peak> peaks;
+    for (int a = 0; a < nb_angles; a++) {
+        for (int r = 0; r < accumulator.cols; r++) {
+            int votes = accumulator.at<int>(a, r);
+            if (votes < HOUGH_THRESHOLD)
+                continue;
+
+            bool maximum = true;
+            for (int da = -1; da <= 1 && maximum; da++) {
+                int an = a + da;
+                bool wrapped = an < 0 || an >= nb_angles;
+                if (wrapped)
+                    an = (an + nb_angles) % nb_angles;
+                if (angles.horizontal[an] != angles.horizontal[a] || (wrapped && angles.horizontal[a]))
+                    continue;
+                for (int dr = -2; dr <= 2 && maximum; dr++) {
+                    int rn = wrapped ? 2 * rho_offset - (r + dr) : r + dr;
+                    if (rn < 0 || rn >= accumulator.cols || (da == 0 && dr == 0))
+                        continue;
+                    int neighbour = accumulator.at<int>(an, rn);
+                    // in case of equality, the first one in the accumulator wins
+                    if (neighbour > votes || (neighbour == votes && (an < a || (an == a && rn < r))))
+                        maximum = false;
+                }
+            }
+
+            if (maximum) {
+                hough_peak peak = { a, r };
+                peaks.push_back(peak);
+            }
+        }
+    }
+
+    vector<vector<Vec4i> > segments(peaks.size());
+    parallel_for_(Range(0, (int)peaks.size()), SegmentsBody(edges, peaks, angles, rho_offset, segments));
+
+    // we sort the segments in the four sets, like hough-transform.cpp:
+    // upper / lower for the horizontal lines, left / right for the vertical lines
+    // WARNING: OpenCV y axis is growing when going down
+    groups.horizontal_up.clear();
+    groups.horizontal_down.clear();
+    groups.vertical_left.clear();
+    groups.vertical_right.clear();
+    for (size_t i = 0; i < peaks.size(); i++) {
+        bool horizontal = angles.horizontal[peaks[i].angle];
+        for (size_t j = 0; j < segments[i].size(); j++) {
+            Vec4i line = segments[i][j];
+            if (horizontal) {
+                if (line[1] < (edges.rows/2) && line[3] < (edges.rows/2))
+                    groups.horizontal_up.push_back(line);
+                else if (line[1] > (edges.rows/2) && line[3] > (edges.rows/2))
+                    groups.horizontal_down.push_back(line);
+            }
+            else {
+                if (line[0] < (edges.cols/2) && line[2] < (edges.cols/2))
+                    groups.vertical_left.push_back(line);
+                else if (line[0] > (edges.cols/2) && line[2] > (edges.cols/2))
+                    groups.vertical_right.push_back(line);
+            }
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef HOUGH_BANDS_H
+#define HOUGH_BANDS_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
+
+#include "line_geometry.h"
+
+using namespace cv;
+using namespace std;
+
+// the lines of the table are almost horizontal or almost vertical: the Hough transform
+// votes only for the angles at less than HOUGH_BAND_DEGREES from these directions
+const int HOUGH_BAND_DEGREES = 5;
+
+// same parameters as the probabilistic Hough transform of hough-transform.cpp
+const int HOUGH_THRESHOLD = 50;         // minimum number of votes of a line
+const int HOUGH_MIN_LINE_LENGTH = 200;  // minimum length of a segment (pixels)
+const int HOUGH_MAX_LINE_GAP = 100;     // maximum gap between two points of the same segment (pixels)
+
+
+void houghBands(const Mat& edges, line_groups& groups);
+
+
+#endif
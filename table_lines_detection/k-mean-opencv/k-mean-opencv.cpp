@@ -13,6 +13,112 @@ using namespace std;
 // - the color of the black edges of the pictures, which come from undistortion algorithm
 const int K = 4;
 
+// How many times the algorithm is executed using different initial labelings.
+// The algorithm returns the labels that yield the best compactness
+// (the attempts are run in parallel, each one with its own seed)
+const int NB_ATTEMPTS = 3;
+
+// seed of the random number generator of the first attempt
+const uint64 KMEAN_SEED = 12345;
+
+// to also run the k-mean for several values of K, and print the compactness for each one, define "K_SWEEP"
+// #define K_SWEEP
+const int K_SWEEP_MIN = 2;
+const int K_SWEEP_MAX = 8;
+
+
+// one run of the k-mean algorithm, with a single attempt
+struct KmeanJob {
+    const Mat* samples;
+    int k;
+    int attempt;
+    double compactness;
+    Mat labels;
+    Mat centers;
+};
+
+// runs a group of k-mean jobs
+class KmeanJobsBody : public ParallelLoopBody {
+public:
+    KmeanJobsBody(vector<KmeanJob>& jobs) : jobs(jobs) {}
+
+    void operator()(const Range& range) const {
+        for (int i = range.start; i < range.end; i++) {
+            KmeanJob& job = jobs[i];
+
+            // the random number generator of OpenCV is local to each thread:
+            // each job has its own seed, so the results don't depend on the scheduling
+            theRNG() = RNG(KMEAN_SEED + i);
+
+            job.compactness = cv::kmeans(*job.samples,  // floating-point matrix of input samples, one row per sample
+                job.k,  // number of clusters to split the set by
+                job.labels,  // the output integer array that will store the cluster indices for every sample
+                TermCriteria( CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 10, 1.0),
+                1, // the attempts are separate jobs
+                KMEANS_PP_CENTERS,  // to select how initial centers are choosen
+                job.centers);  // The output matrix of the cluster centers, one row per each cluster center
+        }
+    }
+
+private:
+    vector<KmeanJob>& jobs;
+};
+
+
+/**
+    Build the matrix of the samples for the k-mean algorithm: one row for each pixel,
+    with 5 columns (y, x, B, G, R), all the values in [0, 1].
+    The colors are converted by a single call for the whole picture, directly into
+    the columns of the matrix, and the coordinates are copied row by row of the picture
+
+    @param src The picture (BGR, 8 bits)
+    @param samples The output matrix of the samples (CV_32F)
+*/
+void buildSamples(const Mat& src, Mat& samples) {
+    int nb_pixels = src.rows * src.cols;
+    samples.create(nb_pixels, 5, CV_32F);
+
+    // the picture seen as one row per pixel and one column per color, without copy
+    // (a submatrix is not continuous, so we copy it in that case)
+    Mat src_continuous = src.isContinuous() ? src : src.clone();
+    Mat colors = samples.colRange(2, 5);
+    src_continuous.reshape(1, nb_pixels).convertTo(colors, CV_32F, 1.0 / 255);
+
+    // the x coordinate is the same for all the rows of the picture
+    Mat x_coordinates(src.cols, 1, CV_32F);
+    for (int j = 0; j < src.cols; j++)
+        x_coordinates.at<float>(j) = (float)j / src.cols;
+
+    for (int i = 0; i < src.rows; i++) {
+        Mat pixels_of_row = samples.rowRange(i * src.cols, (i+1) * src.cols);
+        pixels_of_row.col(0).setTo(Scalar((float)i / src.rows));
+        Mat x_column = pixels_of_row.col(1);
+        x_coordinates.copyTo(x_column);
+    }
+}
+
+// converts the cluster index of each pixel to a grey shade, for the display
+void labelsToGrey(const Mat& labels, Size size, Mat& clustered) {
+    // we convert the number of each one of the K areas to a grey shade
+    uchar colors[K];
+    for(int i=0; i<K; i++) {
+        colors[i] = 255/(i+1);
+    }
+
+    clustered.create(size, CV_8U);
+    const int* label = labels.ptr<int>(0);
+    for (int i = 0; i < size.height; i++) {
+        uchar* row = clustered.ptr<uchar>(i);
+        for (int j = 0; j < size.width; j++)
+            row[j] = colors[label[i * size.width + j]];
+    }
+}
+
+// returns the elapsed time in milliseconds since 'start' (given by getTickCount)
+static double elapsedMs(int64 start) {
+    return (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
+
 int main(int argc, char** argv) {
     // source image
     const char* filename = argc >= 2 ? argv[1] : "table.jpg";
@@ -27,99 +133,93 @@ int main(int argc, char** argv) {
     imshow("source", src);
     cvMoveWindow("source", 0, 30);
 
-    Mat blurred, bestLabels1, bestLabels2, centers, src_clustered, blurred_clustered;
+    Mat blurred, src_clustered, blurred_clustered;
     int display_margin_x = 60;  // margin beetween windows
     int display_margin_y = 60;
 
     // we blur source image
-    blurred = Mat(src.rows, src.cols, CV_32F);
     blur(src, blurred, Size(15,15));  // param 3 is kernel size
     imshow("blurred", blurred);
     cvMoveWindow("blurred", 0+display_margin_x, 30+display_margin_y);
 
     // Nota bene: the k-mean algorithm takes a matrix with src.cols*src.rows rows
-    // and 5 columns (one row for each pixel: x, y, B, G, R)
-    Mat p1 = Mat::zeros(src.cols*src.rows, 5, CV_32F);
-    vector<Mat> bgr1;
-    cv::split(src, bgr1);  // divides a multi-channel array into several single-channel arrays
-    // i think there is a better way to split pixel bgr color
-    for(int i=0; i<src.cols*src.rows; i++) {
-        p1.at<float>(i,0) = (i/src.cols) / src.rows;
-        p1.at<float>(i,1) = (i%src.cols) / src.cols;
-        p1.at<float>(i,2) = bgr1[0].data[i] / 255.0;
-        p1.at<float>(i,3) = bgr1[1].data[i] / 255.0;
-        p1.at<float>(i,4) = bgr1[2].data[i] / 255.0;
-    }
-
-    Mat p2 = Mat::zeros(blurred.cols*blurred.rows, 5, CV_32F);
-    vector<Mat> bgr2;
-    cv::split(blurred, bgr2);
-    // i think there is a better way to split pixel bgr color
-    for(int i=0; i<blurred.cols*blurred.rows; i++) {
-        p2.at<float>(i,0) = (i/blurred.cols) / blurred.rows;
-        p2.at<float>(i,1) = (i%blurred.cols) / blurred.cols;
-        p2.at<float>(i,2) = bgr2[0].data[i] / 255.0;
-        p2.at<float>(i,3) = bgr2[1].data[i] / 255.0;
-        p2.at<float>(i,4) = bgr2[2].data[i] / 255.0;
-    }
-
-    // k-mean on source image, not blurred
-    cv::kmeans(p1,  // floating-point matrix of input samples, one row per sample
-               K,  // number of clusters to split the set by
-               bestLabels1,  // the input/output integer array that will store the cluster indices for every sample
-               TermCriteria( CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 10, 1.0),
-               3, // How many times the algorithm is executed using different initial labelings. 
-                  // The algorithm returns the labels that yield the best compactness
-               KMEANS_PP_CENTERS,  // to select how initial centers are choosen
-               centers);  // The output matrix of the cluster centers, one row per each cluster center
-
-    // k-mean on blurred image
-    cv::kmeans(p2,  // floating-point matrix of input samples, one row per sample
-               K,  // number of clusters to split the set by
-               bestLabels2,  // the input/output integer array that will store the cluster indices for every sample
-               TermCriteria( CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 10, 1.0),
-               3, // How many times the algorithm is executed using different initial labelings. 
-                  // The algorithm returns the labels that yield the best compactness
-               KMEANS_PP_CENTERS,  // to select how initial centers are choosen
-               centers);  // The output matrix of the cluster centers, one row per each cluster center
-
-    // we convert the number of each one of the K areas to a grey shade, for the display 
-    int colors[K];
-    for(int i=0; i<K; i++) {
-        colors[i] = 255/(i+1);
+    // and 5 columns (one row for each pixel: y, x, B, G, R)
+    int64 start = getTickCount();
+    Mat p1, p2;
+    buildSamples(src, p1);
+    buildSamples(blurred, p2);
+    double time_build = elapsedMs(start);
+
+    // the jobs: all the attempts of the k-mean on the source image (not blurred) and on the
+    // blurred image, and optionally on the blurred image for other values of K
+    vector<KmeanJob> jobs;
+    const Mat* samples[2] = { &p1, &p2 };
+    for (int s = 0; s < 2; s++) {
+        for (int attempt = 0; attempt < NB_ATTEMPTS; attempt++) {
+            KmeanJob job;
+            job.samples = samples[s];
+            job.k = K;
+            job.attempt = attempt;
+            jobs.push_back(job);
+        }
     }
-
-    // we fill clustered mat with grey shade, depending on what area the pixel belongs to
-    src_clustered = Mat(src.rows, src.cols, CV_32F);
-    for(int i=0; i<src.cols*src.rows; i++) {
-        src_clustered.at<float>(i/src.cols, i%src.cols) = (float)(colors[bestLabels1.at<int>(0,i)]);
-        // cout << bestLabels.at<int>(0,i) << " " << 
-        //          colors[bestLabels.at<int>(0,i)] << " " << 
-        //          src_clustered.at<float>(i/src.cols, i%src.cols) << " " <<
-        //          endl;
+    #ifdef K_SWEEP
+        for (int k = K_SWEEP_MIN; k <= K_SWEEP_MAX; k++) {
+            if (k == K)
+                continue;
+            for (int attempt = 0; attempt < NB_ATTEMPTS; attempt++) {
+                KmeanJob job;
+                job.samples = &p2;
+                job.k = k;
+                job.attempt = attempt;
+                jobs.push_back(job);
+            }
+        }
+    #endif
+
+    // all the jobs run in parallel, one stripe per job
+    start = getTickCount();
+    parallel_for_(Range(0, (int)jobs.size()), KmeanJobsBody(jobs), (double)jobs.size());
+    double time_clustering = elapsedMs(start);
+
+    cout << "building the samples: " << time_build << " ms" << endl;
+    cout << "clustering (" << jobs.size() << " runs of the k-mean): " << time_clustering << " ms" << endl;
+
+    // for each set of samples and each value of K, we keep the attempt with the best compactness
+    // (the smallest one)
+    KmeanJob* best_src = NULL;
+    KmeanJob* best_blurred = NULL;
+    #ifdef K_SWEEP
+        vector<double> best_compactness(K_SWEEP_MAX + 1, -1);
+    #endif
+    for (size_t i = 0; i < jobs.size(); i++) {
+        KmeanJob& job = jobs[i];
+        if (job.k == K && job.samples == &p1 && (best_src == NULL || job.compactness < best_src->compactness))
+            best_src = &job;
+        if (job.k == K && job.samples == &p2 && (best_blurred == NULL || job.compactness < best_blurred->compactness))
+            best_blurred = &job;
+        #ifdef K_SWEEP
+            if (job.samples == &p2 && (best_compactness[job.k] < 0 || job.compactness < best_compactness[job.k]))
+                best_compactness[job.k] = job.compactness;
+        #endif
     }
+    #ifdef K_SWEEP
+        for (int k = K_SWEEP_MIN; k <= K_SWEEP_MAX; k++)
+            cout << "K = " << k << ": compactness " << best_compactness[k] << endl;
+    #endif
 
     // we fill clustered mat with grey shade, depending on what area the pixel belongs to
-    blurred_clustered = Mat(src.rows, src.cols, CV_32F);
-    for(int i=0; i<src.cols*src.rows; i++) {
-        blurred_clustered.at<float>(i/src.cols, i%src.cols) = (float)(colors[bestLabels2.at<int>(0,i)]);
-        // cout << bestLabels.at<int>(0,i) << " " << 
-        //          colors[bestLabels.at<int>(0,i)] << " " << 
-        //          blurred_clustered.at<float>(i/src.cols, i%src.cols) << " " <<
-        //          endl;
-    }
+    labelsToGrey(best_src->labels, src.size(), src_clustered);
+    labelsToGrey(best_blurred->labels, src.size(), blurred_clustered);
 
     // we display source clustered image
-    src_clustered.convertTo(src_clustered, CV_8U);
     imshow("source clustered not blurred", src_clustered);
     cvMoveWindow("source clustered not blurred", 0+2*display_margin_x, 30);
 
     // we display blurred clustered image
-    blurred_clustered.convertTo(blurred_clustered, CV_8U);
     imshow("blurred before clustered", blurred_clustered);
     cvMoveWindow("blurred before clustered", 0+2*display_margin_x, 30+2*display_margin_y);
 
     waitKey();
     return 0;
 }
-
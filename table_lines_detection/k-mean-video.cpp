@@ -0,0 +1,118 @@
+#include <opencv/cv.h>
+#include <opencv/highgui.h>
+#include <iostream>
+
+#include "kmean.h"
+#include "color_lut.h"
+
+using namespace cv;
+using namespace std;
+
+// to display the pixels of the class of the table lines for each frame, define "SHOW_WINDOWS"
+// (the whole frame is then blurred and binarized with the lookup table at each frame)
+// #define SHOW_WINDOWS
+
+
+// returns the elapsed time in milliseconds since 'start' (given by getTickCount)
+static double elapsedMs(int64 start) {
+    return (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
+
+int main(int argc, char** argv) {
+    // we get the filename of the video file to use
+    if (argc == 1) {
+        cerr << "Please give the video filename as an argument" << endl;
+        exit(1);
+    }
+    const string videofilename = argv[1];
+
+    // if a second filename is given, the lookup table of the classes of the last frame
+    // is written to that file
+    const char* lut_filename = argc >= 3 ? argv[2] : NULL;
+
+    VideoCapture capture(videofilename);
+    if (!capture.isOpened()) {
+        cerr << "Error when reading video file" << endl;
+        exit(1);
+    }
+
+    Mat frame, lut, line_mask, line_mask_filtered;
+    vector<Mat> BGR;
+    LineMaskFilter line_mask_filter;
+    kmean_stream stream;
+    RNG rng(KMEAN_RNG_SEED);
+
+    int nb_frames = 0, nb_reclusters = 0;
+    double time_updates = 0, time_reclusters = 0;
+
+    while (true) {
+        capture >> frame;
+        if (frame.empty())
+            break;
+
+        // the whole frame is blurred to remove noise, and split in 3 layers (B, G, R), only
+        // when it is needed by a full k-mean: the updates blur only the pixels of their sample.
+        // The timings include that preprocessing
+        int64 start = getTickCount();
+        bool recluster = nb_frames == 0;
+        if (!recluster) {
+            // the centroids of the previous frame are updated with a sample of the pixels,
+            // and we run a full k-mean only if the table segmentation has changed too much
+            recluster = kmeanStreamUpdate(frame, BLUR_KERNEL_LENGTH, stream, rng);
+            time_updates += elapsedMs(start);
+            if (recluster)
+                cout << "frame " << nb_frames << ": drift " << stream.drift
+                     << ", population change " << stream.population_change << ", full k-mean" << endl;
+        }
+
+        if (recluster) {
+            start = getTickCount();
+            GaussianBlur(frame, frame, Size(BLUR_KERNEL_LENGTH, BLUR_KERNEL_LENGTH), 0, 0);
+            split(frame, BGR);
+            if (nb_frames == 0)
+                kmeanStreamInit(BGR, stream, rng);  // first frame: full k-mean
+            else
+                kmeanStreamRecluster(BGR, stream);
+            time_reclusters += elapsedMs(start);
+            nb_reclusters++;
+        }
+        nb_frames++;
+
+        #ifdef SHOW_WINDOWS
+            // we display the pixels of the class of the table lines: the centroids are compiled
+            // into a lookup table (32768 entries, much less than the pixels of the frame),
+            // which gives the class of each pixel with a single lookup
+            if (!recluster)
+                GaussianBlur(frame, frame, Size(BLUR_KERNEL_LENGTH, BLUR_KERNEL_LENGTH), 0, 0);
+            buildColorLut(stream.centroids, lut);
+            applyColorLut(frame, lut, LINE_CLASS_NUMBER, line_mask);
+            line_mask_filter.apply(line_mask, line_mask_filtered);
+            imshow("k-mean video", line_mask_filtered);
+            if (waitKey(1) == 27)  // escape
+                break;
+        #endif
+    }
+
+    if (nb_frames == 0) {
+        cerr << "The video has no frames" << endl;
+        exit(1);
+    }
+
+    if (lut_filename != NULL) {
+        buildColorLut(stream.centroids, lut);
+        if (saveColorLut(lut_filename, lut, stream.centroids))
+            cout << "lookup table written to " << lut_filename << endl;
+        else
+            cerr << "Error when writing lookup table file " << lut_filename << endl;
+    }
+
+    int nb_updates = nb_frames - 1;
+    cout << nb_frames << " frames, " << nb_reclusters << " full k-mean" << endl;
+    cout << "blur and full k-mean: " << time_reclusters / nb_reclusters << " ms per frame" << endl;
+    if (nb_updates > 0)
+        cout << "update with " << STREAM_NB_SAMPLES << " blurred pixels: "
+             << time_updates / nb_updates << " ms per frame" << endl;
+    cout << "mean k-mean time: " << (time_updates + time_reclusters) / nb_frames << " ms per frame" << endl;
+
+    return 0;
+}
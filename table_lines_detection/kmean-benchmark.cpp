@@ -0,0 +1,151 @@
+#include <opencv/cv.h>
+#include <opencv/highgui.h>
+#include <iostream>
+#include <string.h>
+
+#include "kmean.h"
+
+using namespace cv;
+using namespace std;
+
+// number of runs of each algorithm, we keep the mean time
+const int NB_RUNS = 5;
+
+
+// returns the elapsed time in milliseconds since 'start' (given by getTickCount)
+static double elapsedMs(int64 start) {
+    return (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
+
+static void printCentroids(const point* centroids) {
+    for (int k = 0; k < K; k++)
+        cout << "    class " << k << ": B " << centroids[k].B << ", G " << centroids[k].G
+             << ", R " << centroids[k].R << endl;
+}
+
+int main(int argc, char** argv) {
+    // source image
+    const char* filename = argc >= 2 ? argv[1] : "table.jpg";
+
+    Mat src = imread(filename, CV_LOAD_IMAGE_COLOR);
+    if( src.empty() )
+    {
+        cout << "Couldn't load " << filename << endl;
+        exit(1);
+    }
+    cout << "picture " << filename << ": " << src.cols << "x" << src.rows << ", "
+         << getNumThreads() << " threads, mean of " << NB_RUNS << " runs" << endl;
+
+    // all the runs start with the same centroids
+    point centroids_init[K], centroids_old[K];
+    RNG rng(KMEAN_RNG_SEED);
+    initialize_centroids(centroids_init, centroids_old, rng);
+
+    vector<Mat> BGR;
+    split(src, BGR);
+
+
+    // ===== custom k-mean on all the pixels =====
+    point centroids_pixels[K];
+    Mat labels_pixels(src.size(), CV_8U);
+    int iterations_pixels = 0;
+    int64 start = getTickCount();
+    for (int run = 0; run < NB_RUNS; run++) {
+        memcpy(centroids_pixels, centroids_init, sizeof(centroids_pixels));
+        iterations_pixels = kmeanPixels(BGR, centroids_pixels, labels_pixels);
+    }
+    double time_pixels = elapsedMs(start) / NB_RUNS;
+
+    cout << endl << "custom k-mean on the pixels: " << time_pixels << " ms, "
+         << iterations_pixels << " iterations" << endl;
+    printCentroids(centroids_pixels);
+
+
+    // ===== accelerated custom k-mean on all the pixels =====
+    point centroids_accelerated[K];
+    Mat labels_accelerated(src.size(), CV_8U);
+    int iterations_accelerated = 0;
+    start = getTickCount();
+    for (int run = 0; run < NB_RUNS; run++) {
+        memcpy(centroids_accelerated, centroids_init, sizeof(centroids_accelerated));
+        iterations_accelerated = kmeanAccelerated(BGR, centroids_accelerated, labels_accelerated);
+    }
+    double time_accelerated = elapsedMs(start) / NB_RUNS;
+
+    cout << endl << "accelerated custom k-mean on the pixels: " << time_accelerated << " ms, "
+         << iterations_accelerated << " iterations" << endl
+         << "    same class as the k-mean on the pixels for "
+         << 100.0 * countNonZero(labels_pixels == labels_accelerated) / src.total() << "% of the pixels" << endl;
+    printCentroids(centroids_accelerated);
+
+
+    // ===== custom k-mean on the color histogram =====
+    // the time includes the histogram, and the final pass which gives the class of each pixel
+    point centroids_histogram[K];
+    Mat labels_histogram(src.size(), CV_8U);
+    vector<class_sum> bins;
+    class_sum sums[K];
+    int iterations_histogram = 0;
+    double time_build = 0, time_iterations = 0, time_assign = 0;
+    for (int run = 0; run < NB_RUNS; run++) {
+        memcpy(centroids_histogram, centroids_init, sizeof(centroids_histogram));
+
+        start = getTickCount();
+        buildColorHistogram(src, bins);
+        time_build += elapsedMs(start);
+
+        start = getTickCount();
+        iterations_histogram = kmeanHistogram(bins, centroids_histogram);
+        time_iterations += elapsedMs(start);
+
+        start = getTickCount();
+        kmeanAssign(BGR, centroids_histogram, labels_histogram, sums);
+        time_assign += elapsedMs(start);
+    }
+    double time_histogram = (time_build + time_iterations + time_assign) / NB_RUNS;
+
+    // we compare the classes of the pixels with the ones given by the k-mean on the pixels
+    int nb_same_labels = countNonZero(labels_pixels == labels_histogram);
+
+    cout << endl << "custom k-mean on the color histogram: " << time_histogram << " ms, "
+         << iterations_histogram << " iterations" << endl
+         << "    histogram " << time_build / NB_RUNS << " ms (" << bins.size() << " occupied bins), "
+         << "iterations " << time_iterations / NB_RUNS << " ms, "
+         << "classes of the pixels " << time_assign / NB_RUNS << " ms" << endl
+         << "    same class as the k-mean on the pixels for "
+         << 100.0 * nb_same_labels / src.total() << "% of the pixels" << endl;
+    printCentroids(centroids_histogram);
+
+
+    // ===== OpenCV k-mean, like k-mean-opencv.cpp =====
+    // one row for each pixel: x, y, B, G, R
+    start = getTickCount();
+    Mat samples(src.cols*src.rows, 5, CV_32F);
+    for(int i=0; i<src.cols*src.rows; i++) {
+        samples.at<float>(i,0) = (float)(i/src.cols) / src.rows;
+        samples.at<float>(i,1) = (float)(i%src.cols) / src.cols;
+        samples.at<float>(i,2) = BGR[0].data[i] / 255.0;
+        samples.at<float>(i,3) = BGR[1].data[i] / 255.0;
+        samples.at<float>(i,4) = BGR[2].data[i] / 255.0;
+    }
+    double time_samples = elapsedMs(start);
+
+    // only one run, because it's much slower
+    Mat labels_opencv, centers;
+    start = getTickCount();
+    cv::kmeans(samples, K, labels_opencv, TermCriteria( CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 10, 1.0),
+               3, KMEANS_PP_CENTERS, centers);
+    double time_opencv = elapsedMs(start);
+
+    cout << endl << "OpenCV k-mean (5 columns, 3 attempts): " << time_opencv << " ms, "
+         << "and " << time_samples << " ms to build the samples" << endl;
+
+
+    cout << endl << "speedup of the accelerated k-mean: " << time_pixels / time_accelerated
+         << "x over the custom k-mean on the pixels" << endl;
+    cout << "speedup of the histogram: " << time_pixels / time_histogram
+         << "x over the custom k-mean on the pixels, "
+         << (time_opencv + time_samples) / time_histogram << "x over the OpenCV k-mean" << endl;
+
+    return 0;
+}
@@ -0,0 +1,796 @@
+#include "kmean.h"
+
+#include <math.h>
+#include <string.h>
+#include <climits>
+#include <cfloat>
+#include <mutex>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+
+// initialize centroid with random value
+void initialize_centroid_with_rand(point* c, RNG& rng) {
+    c->R = rng.uniform(0, 255);
+    c->G = rng.uniform(0, 255);
+    c->B = rng.uniform(0, 255);
+    c->fixed = false;
+}
+
+// initialize fixed centroid with tab
+void initialize_fixed_centroid_with_tab(point* c, point* c_old, int* values) {
+    c->R = values[0];  c_old->R = values[0];
+    c->G = values[1];  c_old->G = values[1];
+    c->B = values[2];  c_old->B = values[2];
+    c->fixed = true;
+}
+
+// compute the distance between two points
+float distance(point vect1, point vect2) {
+    int x = 0, y = 0, z = 0;
+    x = vect2.R - vect1.R;
+    y = vect2.G - vect1.G;
+    z = vect2.B - vect1.B;
+    return sqrt(pow(x,2) + pow(y,2) + pow(z,2));
+}
+
+// k-mean first step: we initialize the centroids
+void initialize_centroids(point* centroids, point* centroids_old, RNG& rng) {
+    // first, we initialize everything with random value, but it will be overriden
+    // by specific values if user defines specific color values for the centroids
+    for (int i=0; i<K; i++)
+        initialize_centroid_with_rand(&centroids[i], rng);
+
+    #ifdef CENTROID_LINE
+        int centroid_0_tmp[3] = CENTROID_LINE;
+        initialize_fixed_centroid_with_tab(&centroids[LINE_CLASS_NUMBER], &centroids_old[LINE_CLASS_NUMBER],
+                                            centroid_0_tmp);
+    #endif
+
+    #ifdef CENTROID_TABLE
+        int centroid_1_tmp[3] = CENTROID_TABLE;
+        initialize_fixed_centroid_with_tab(&centroids[TABLE_CLASS_NUMBER], &centroids_old[TABLE_CLASS_NUMBER],
+                                            centroid_1_tmp);
+    #endif
+
+    #ifdef CENTROID_EDGE
+        int centroid_3_tmp[3] = CENTROID_EDGE;
+        initialize_fixed_centroid_with_tab(&centroids[EDGE_CLASS_NUMBER], &centroids_old[EDGE_CLASS_NUMBER],
+                                            centroid_3_tmp);
+    #endif
+}
+
+// we compute the new positions of centroids from the sums of the pixel values of each class,
+// unless centroids are fixed (if they have been defined by the user)
+// return value: the gap (termination condition), the mean of the distance between
+// the new centroids and the previous ones
+int update_centroids(point* centroids, point* centroids_old, const class_sum* sums, RNG& rng) {
+    for (int i=0; i<K; i++) {
+        if (centroids[i].fixed == false) {
+            // we record old centroids value (used in the termination condition)
+            centroids_old[i].B = centroids[i].B;
+            centroids_old[i].G = centroids[i].G;
+            centroids_old[i].R = centroids[i].R;
+
+            // for each class, we make the mean pixel value on each color
+            // and we replace the centroid of that class with the new values
+            if (sums[i].nb_pixels != 0) {
+                centroids[i].B = (int)(sums[i].B / sums[i].nb_pixels);
+                centroids[i].G = (int)(sums[i].G / sums[i].nb_pixels);
+                centroids[i].R = (int)(sums[i].R / sums[i].nb_pixels);
+            } else {
+                // we choose a random value for the centroid
+                initialize_centroid_with_rand(&centroids[i], rng);
+            }
+        }
+    }
+
+    int gap = 0;
+    for (int i=0; i<K; i++) {
+        // we don't compute the distance between current and previous iteration
+        // for fixed centroids, because it's always 0
+        if (centroids[i].fixed == false)
+            gap += distance(centroids[i], centroids_old[i]);
+    }
+    return gap / K;
+}
+
+
+#if defined(__SSE2__)
+// selects the values of a where mask is set, and the values of b elsewhere
+static inline __m128i selectBits(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif
+
+// assignment step for one row of the picture:
+// we search the closest centroid of each pixel, then we add the pixel to the sums of its class
+static void assignRow(const uchar* b, const uchar* g, const uchar* r, int n,
+                      const point* centroids, uchar* labels, class_sum* sums) {
+    int j = 0;
+
+#if defined(__SSE2__)
+    // we process the pixels 16 by 16: the 3 colors are loaded from the 3 planes,
+    // and the squared distances are computed with 16 bits differences and 32 bits sums
+    const __m128i zero = _mm_setzero_si128();
+    __m128i centroid_B[K], centroid_G[K], centroid_R[K];
+    for (int k = 0; k < K; k++) {
+        centroid_B[k] = _mm_set1_epi16((short)centroids[k].B);
+        centroid_G[k] = _mm_set1_epi16((short)centroids[k].G);
+        centroid_R[k] = _mm_set1_epi16((short)centroids[k].R);
+    }
+
+    for (; j <= n - 16; j += 16) {
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+        __m128i vg = _mm_loadu_si128((const __m128i*)(g + j));
+        __m128i vr = _mm_loadu_si128((const __m128i*)(r + j));
+
+        // the 16 pixels as 2 halves of 8 pixels, with 16 bits per color
+        __m128i b16[2] = { _mm_unpacklo_epi8(vb, zero), _mm_unpackhi_epi8(vb, zero) };
+        __m128i g16[2] = { _mm_unpacklo_epi8(vg, zero), _mm_unpackhi_epi8(vg, zero) };
+        __m128i r16[2] = { _mm_unpacklo_epi8(vr, zero), _mm_unpackhi_epi8(vr, zero) };
+
+        // closest distance and class found so far, as 4 quarters of 4 pixels (32 bits)
+        __m128i best_dist[4], best_label[4];
+
+        for (int k = 0; k < K; k++) {
+            __m128i label = _mm_set1_epi32(k);
+            for (int h = 0; h < 2; h++) {
+                __m128i db = _mm_sub_epi16(b16[h], centroid_B[k]);
+                __m128i dg = _mm_sub_epi16(g16[h], centroid_G[k]);
+                __m128i dr = _mm_sub_epi16(r16[h], centroid_R[k]);
+
+                // madd multiplies the 16 bits pairs and adds them: (db,dg) pairs give db*db + dg*dg,
+                // (dr,0) pairs give dr*dr
+                __m128i bg_lo = _mm_unpacklo_epi16(db, dg), bg_hi = _mm_unpackhi_epi16(db, dg);
+                __m128i r_lo  = _mm_unpacklo_epi16(dr, zero), r_hi = _mm_unpackhi_epi16(dr, zero);
+                __m128i dist[2] = {
+                    _mm_add_epi32(_mm_madd_epi16(bg_lo, bg_lo), _mm_madd_epi16(r_lo, r_lo)),
+                    _mm_add_epi32(_mm_madd_epi16(bg_hi, bg_hi), _mm_madd_epi16(r_hi, r_hi))
+                };
+
+                for (int q = 0; q < 2; q++) {
+                    int quarter = 2*h + q;
+                    if (k == 0) {
+                        best_dist[quarter]  = dist[q];
+                        best_label[quarter] = zero;
+                    }
+                    else {
+                        // like the scalar version, in case of equality the first centroid wins
+                        __m128i closer = _mm_cmplt_epi32(dist[q], best_dist[quarter]);
+                        best_dist[quarter]  = selectBits(closer, dist[q], best_dist[quarter]);
+                        best_label[quarter] = selectBits(closer, label, best_label[quarter]);
+                    }
+                }
+            }
+        }
+
+        // we pack the 16 class numbers from 32 to 8 bits
+        __m128i labels_lo = _mm_packs_epi32(best_label[0], best_label[1]);
+        __m128i labels_hi = _mm_packs_epi32(best_label[2], best_label[3]);
+        _mm_storeu_si128((__m128i*)(labels + j), _mm_packus_epi16(labels_lo, labels_hi));
+    }
+#endif
+
+    // remaining pixels (or all the pixels, without SSE2)
+    for (; j < n; j++) {
+        int dist_min = INT_MAX;
+        int candidate = 0;
+        for (int k = 0; k < K; k++) {
+            int db = b[j] - centroids[k].B;
+            int dg = g[j] - centroids[k].G;
+            int dr = r[j] - centroids[k].R;
+            int dist = db*db + dg*dg + dr*dr;
+            if (dist < dist_min) {
+                dist_min = dist;
+                candidate = k;
+            }
+        }
+        labels[j] = (uchar)candidate;
+    }
+
+    // accumulation step, fused with the assignment: the row is still in the cache
+    for (j = 0; j < n; j++) {
+        class_sum& sum = sums[labels[j]];
+        sum.nb_pixels++;
+        sum.B += b[j];
+        sum.G += g[j];
+        sum.R += r[j];
+    }
+}
+
+// adds the sums of a stripe to the total sums
+static void mergeSums(class_sum* sums, const class_sum* stripe_sums, mutex* sums_mutex) {
+    lock_guard<mutex> lock(*sums_mutex);
+    for (int k = 0; k < K; k++) {
+        sums[k].nb_pixels += stripe_sums[k].nb_pixels;
+        sums[k].B += stripe_sums[k].B;
+        sums[k].G += stripe_sums[k].G;
+        sums[k].R += stripe_sums[k].R;
+    }
+}
+
+// assignment and accumulation steps for a stripe of rows
+class AssignBody : public ParallelLoopBody {
+public:
+    AssignBody(const vector<Mat>& BGR, const point* centroids, Mat& kmean_class_number,
+               class_sum* sums, mutex* sums_mutex)
+        : BGR(BGR), centroids(centroids), kmean_class_number(kmean_class_number),
+          sums(sums), sums_mutex(sums_mutex) {}
+
+    void operator()(const Range& range) const {
+        // each stripe has its own sums, which are added to the total at the end
+        class_sum stripe_sums[K];
+        memset(stripe_sums, 0, sizeof(stripe_sums));
+
+        for (int i = range.start; i < range.end; i++)
+            assignRow(BGR[0].ptr<uchar>(i), BGR[1].ptr<uchar>(i), BGR[2].ptr<uchar>(i), BGR[0].cols,
+                      centroids, kmean_class_number.ptr<uchar>(i), stripe_sums);
+
+        mergeSums(sums, stripe_sums, sums_mutex);
+    }
+
+private:
+    const vector<Mat>& BGR;
+    const point* centroids;
+    Mat& kmean_class_number;
+    class_sum* sums;
+    mutex* sums_mutex;
+};
+
+/**
+    k-mean 2nd and 3rd steps, in a single pass over the picture: for each pixel we search
+    the nearest centroid (with integer squared distances), and we sum the values of the pixels
+    of each class. The stripes of rows are processed in parallel
+
+    @param BGR The picture, split in 3 planes (B, G, R)
+    @param centroids The K centroids
+    @param kmean_class_number The output class number of each pixel (CV_8U)
+    @param sums The output number of pixels and sum of the pixel values, for each class
+*/
+void kmeanAssign(const vector<Mat>& BGR, const point* centroids, Mat& kmean_class_number, class_sum* sums) {
+    kmean_class_number.create(BGR[0].size(), CV_8U);
+    memset(sums, 0, K * sizeof(class_sum));
+
+    mutex sums_mutex;
+    parallel_for_(Range(0, BGR[0].rows), AssignBody(BGR, centroids, kmean_class_number, sums, &sums_mutex));
+}
+
+/**
+    The k-mean algorithm on all the pixels of the picture, without display
+
+    @param BGR The picture, split in 3 planes (B, G, R)
+    @param centroids The initial centroids, and the output final centroids
+    @param kmean_class_number The output class number of each pixel (CV_8U)
+    @return The number of iterations
+*/
+int kmeanPixels(const vector<Mat>& BGR, point* centroids, Mat& kmean_class_number) {
+    point centroids_old[K];
+    memcpy(centroids_old, centroids, sizeof(centroids_old));
+    class_sum sums[K];
+    RNG rng(KMEAN_RNG_SEED);
+
+    int iteration_number = 0;
+    int gap;
+    do {
+        kmeanAssign(BGR, centroids, kmean_class_number, sums);
+        gap = update_centroids(centroids, centroids_old, sums, rng);
+        iteration_number++;
+    } while (gap > 1);
+
+    return iteration_number;
+}
+
+
+// squared distance between a pixel and a centroid
+static inline int squaredDistance(int b, int g, int r, const point& centroid) {
+    int db = b - centroid.B;
+    int dg = g - centroid.G;
+    int dr = r - centroid.R;
+    return db*db + dg*dg + dr*dr;
+}
+
+// adds (sign = 1) or removes (sign = -1) a pixel to the sums of a class
+static inline void addToSum(class_sum& sum, int b, int g, int r, int sign) {
+    sum.nb_pixels += sign;
+    sum.B += sign * b;
+    sum.G += sign * g;
+    sum.R += sign * r;
+}
+
+// searches the closest and the second closest centroids of a pixel
+// (squared distances)
+static inline int closestCentroids(int b, int g, int r, const point* centroids,
+                                   int* dist_closest, int* dist_second) {
+    int d1 = INT_MAX, d2 = INT_MAX;
+    int candidate = 0;
+    for (int k = 0; k < K; k++) {
+        int dist = squaredDistance(b, g, r, centroids[k]);
+        if (dist < d1) {
+            d2 = d1;
+            d1 = dist;
+            candidate = k;
+        }
+        else if (dist < d2)
+            d2 = dist;
+    }
+    *dist_closest = d1;
+    *dist_second = d2;
+    return candidate;
+}
+
+// first assignment of the accelerated k-mean for a stripe of rows:
+// we compute all the distances, to initialize the bounds
+class AssignBoundsBody : public ParallelLoopBody {
+public:
+    AssignBoundsBody(const vector<Mat>& BGR, const point* centroids, Mat& kmean_class_number,
+                     kmean_bounds& bounds, class_sum* sums, mutex* sums_mutex)
+        : BGR(BGR), centroids(centroids), kmean_class_number(kmean_class_number),
+          bounds(bounds), sums(sums), sums_mutex(sums_mutex) {}
+
+    void operator()(const Range& range) const {
+        class_sum stripe_sums[K];
+        memset(stripe_sums, 0, sizeof(stripe_sums));
+
+        for (int i = range.start; i < range.end; i++) {
+            const uchar* b = BGR[0].ptr<uchar>(i);
+            const uchar* g = BGR[1].ptr<uchar>(i);
+            const uchar* r = BGR[2].ptr<uchar>(i);
+            uchar* labels = kmean_class_number.ptr<uchar>(i);
+            float* upper = bounds.upper.ptr<float>(i);
+            float* lower = bounds.lower.ptr<float>(i);
+
+            for (int j = 0; j < BGR[0].cols; j++) {
+                int d1, d2;
+                int candidate = closestCentroids(b[j], g[j], r[j], centroids, &d1, &d2);
+                labels[j] = (uchar)candidate;
+                upper[j] = sqrtf((float)d1);
+                lower[j] = sqrtf((float)d2);
+                addToSum(stripe_sums[candidate], b[j], g[j], r[j], 1);
+            }
+        }
+
+        mergeSums(sums, stripe_sums, sums_mutex);
+    }
+
+private:
+    const vector<Mat>& BGR;
+    const point* centroids;
+    Mat& kmean_class_number;
+    kmean_bounds& bounds;
+    class_sum* sums;
+    mutex* sums_mutex;
+};
+
+/**
+    First assignment step of the accelerated k-mean: for each pixel we search the nearest
+    centroid, and we initialize the bounds of its distances to the centroids
+
+    @param BGR The picture, split in 3 planes (B, G, R)
+    @param centroids The K centroids
+    @param kmean_class_number The output class number of each pixel (CV_8U)
+    @param bounds The output bounds of the distances of each pixel
+    @param sums The output number of pixels and sum of the pixel values, for each class
+*/
+void kmeanAssignBounds(const vector<Mat>& BGR, const point* centroids, Mat& kmean_class_number,
+                       kmean_bounds& bounds, class_sum* sums) {
+    kmean_class_number.create(BGR[0].size(), CV_8U);
+    bounds.upper.create(BGR[0].size(), CV_32F);
+    bounds.lower.create(BGR[0].size(), CV_32F);
+    memset(sums, 0, K * sizeof(class_sum));
+
+    mutex sums_mutex;
+    parallel_for_(Range(0, BGR[0].rows),
+                  AssignBoundsBody(BGR, centroids, kmean_class_number, bounds, sums, &sums_mutex));
+}
+
+
+// the values computed once per iteration from the centroids, used by all the pixels
+typedef struct {
+    float shift[K];            // distance moved by each centroid during the last update
+    float max_other_shift[K];  // biggest distance moved by the centroids of the other classes
+    float half_nearest[K];     // half of the distance to the nearest other centroid
+} centroids_moves;
+
+// assignment step of the accelerated k-mean for a stripe of rows:
+// a pixel can't change class if its distance to its centroid is smaller than the distance
+// to all the other centroids, and the bounds often prove it without computing any distance
+class UpdateBoundsBody : public ParallelLoopBody {
+public:
+    UpdateBoundsBody(const vector<Mat>& BGR, const point* centroids, const centroids_moves& moves,
+                     Mat& kmean_class_number, kmean_bounds& bounds, class_sum* sums,
+                     int64_t* nb_distances, mutex* sums_mutex)
+        : BGR(BGR), centroids(centroids), moves(moves), kmean_class_number(kmean_class_number),
+          bounds(bounds), sums(sums), nb_distances(nb_distances), sums_mutex(sums_mutex) {}
+
+    void operator()(const Range& range) const {
+        // the sums are updated incrementally: each stripe records the moves of its pixels
+        class_sum stripe_sums[K];
+        memset(stripe_sums, 0, sizeof(stripe_sums));
+        int64_t stripe_distances = 0;
+
+        for (int i = range.start; i < range.end; i++) {
+            const uchar* b = BGR[0].ptr<uchar>(i);
+            const uchar* g = BGR[1].ptr<uchar>(i);
+            const uchar* r = BGR[2].ptr<uchar>(i);
+            uchar* labels = kmean_class_number.ptr<uchar>(i);
+            float* upper = bounds.upper.ptr<float>(i);
+            float* lower = bounds.lower.ptr<float>(i);
+
+            for (int j = 0; j < BGR[0].cols; j++) {
+                int label = labels[j];
+
+                // the centroids moved: the distances can't have changed more than their moves
+                upper[j] += moves.shift[label];
+                lower[j] -= moves.max_other_shift[label];
+
+                float threshold = max(moves.half_nearest[label], lower[j]);
+                if (upper[j] <= threshold)
+                    continue;
+
+                // the upper bound may be too loose: we compute the real distance
+                upper[j] = sqrtf((float)squaredDistance(b[j], g[j], r[j], centroids[label]));
+                stripe_distances++;
+                if (upper[j] <= threshold)
+                    continue;
+
+                // we can't conclude: we compute the distances to all the centroids
+                int d1, d2;
+                int candidate = closestCentroids(b[j], g[j], r[j], centroids, &d1, &d2);
+                stripe_distances += K;
+                upper[j] = sqrtf((float)d1);
+                lower[j] = sqrtf((float)d2);
+
+                if (candidate != label) {
+                    labels[j] = (uchar)candidate;
+                    addToSum(stripe_sums[label], b[j], g[j], r[j], -1);
+                    addToSum(stripe_sums[candidate], b[j], g[j], r[j], 1);
+                }
+            }
+        }
+
+        mergeSums(sums, stripe_sums, sums_mutex);
+        lock_guard<mutex> lock(*sums_mutex);
+        *nb_distances += stripe_distances;
+    }
+
+private:
+    const vector<Mat>& BGR;
+    const point* centroids;
+    const centroids_moves& moves;
+    Mat& kmean_class_number;
+    kmean_bounds& bounds;
+    class_sum* sums;
+    int64_t* nb_distances;
+    mutex* sums_mutex;
+};
+
+/**
+    Assignment step of the accelerated k-mean (Hamerly's algorithm): the bounds of each pixel
+    are updated with the moves of the centroids, and the distances are computed only for the
+    pixels which may change class. The sums are updated only for the pixels which changed class,
+    so the last iterations, where only a few pixels move, are almost free
+
+    @param BGR The picture, split in 3 planes (B, G, R)
+    @param centroids_previous The centroids used by the previous assignment step
+    @param centroids The new centroids
+    @param kmean_class_number The class number of each pixel, updated
+    @param bounds The bounds of the distances of each pixel, updated
+    @param sums The number of pixels and sum of the pixel values for each class, updated
+    @return The number of distances computed
+*/
+int64_t kmeanUpdateBounds(const vector<Mat>& BGR, const point* centroids_previous, const point* centroids,
+                          Mat& kmean_class_number, kmean_bounds& bounds, class_sum* sums) {
+    centroids_moves moves;
+    for (int k = 0; k < K; k++)
+        moves.shift[k] = distance(centroids[k], centroids_previous[k]);
+
+    for (int k = 0; k < K; k++) {
+        moves.max_other_shift[k] = 0;
+        moves.half_nearest[k] = FLT_MAX;
+        for (int other = 0; other < K; other++) {
+            if (other == k)
+                continue;
+            moves.max_other_shift[k] = max(moves.max_other_shift[k], moves.shift[other]);
+            moves.half_nearest[k] = min(moves.half_nearest[k], distance(centroids[k], centroids[other]) / 2);
+        }
+    }
+
+    int64_t nb_distances = 0;
+    mutex sums_mutex;
+    parallel_for_(Range(0, BGR[0].rows),
+                  UpdateBoundsBody(BGR, centroids, moves, kmean_class_number, bounds, sums,
+                                   &nb_distances, &sums_mutex));
+    return nb_distances;
+}
+
+/**
+    The accelerated k-mean algorithm on all the pixels of the picture, without display.
+    It gives the same result as kmeanPixels (except for the pixels at the same distance
+    of two centroids), with much less distance computations
+
+    @param BGR The picture, split in 3 planes (B, G, R)
+    @param centroids The initial centroids, and the output final centroids
+    @param kmean_class_number The output class number of each pixel (CV_8U)
+    @param class_sums If not NULL, the output number of pixels and sum of the pixel values
+                      of each class of kmean_class_number (K elements)
+    @return The number of iterations
+*/
+int kmeanAccelerated(const vector<Mat>& BGR, point* centroids, Mat& kmean_class_number,
+                     class_sum* class_sums) {
+    point centroids_old[K], centroids_previous[K];
+    memcpy(centroids_old, centroids, sizeof(centroids_old));
+    class_sum sums[K];
+    kmean_bounds bounds;
+    RNG rng(KMEAN_RNG_SEED);
+
+    kmeanAssignBounds(BGR, centroids, kmean_class_number, bounds, sums);
+    int iteration_number = 1;
+    while (true) {
+        memcpy(centroids_previous, centroids, sizeof(centroids_previous));
+        if (update_centroids(centroids, centroids_old, sums, rng) <= 1)
+            break;
+        kmeanUpdateBounds(BGR, centroids_previous, centroids, kmean_class_number, bounds, sums);
+        iteration_number++;
+    }
+
+    // the sums are kept up to date with the classes of the pixels by the assignment steps
+    if (class_sums != NULL)
+        memcpy(class_sums, sums, sizeof(sums));
+    return iteration_number;
+}
+
+
+/**
+    Full k-mean of a frame of a video, starting from the current centroids of the stream
+    (they are close to the result, so it needs only a few iterations)
+
+    @param BGR The frame, split in 3 planes (B, G, R)
+    @param stream The state of the k-mean on the video, updated
+*/
+void kmeanStreamRecluster(const vector<Mat>& BGR, kmean_stream& stream) {
+    Mat kmean_class_number;
+    class_sum sums[K];
+    kmeanAccelerated(BGR, stream.centroids, kmean_class_number, sums);
+
+    int64_t nb_pixels = (int64_t)BGR[0].total();
+    for (int k = 0; k < K; k++) {
+        stream.B[k] = stream.centroids[k].B;
+        stream.G[k] = stream.centroids[k].G;
+        stream.R[k] = stream.centroids[k].R;
+        stream.counts[k] = 0;
+        stream.reference[k] = stream.centroids[k];
+        stream.population[k] = (float)sums[k].nb_pixels / nb_pixels;
+    }
+    stream.drift = 0;
+    stream.population_change = 0;
+}
+
+/**
+    Initialize the k-mean on a video with a full k-mean of its first frame
+
+    @param BGR The first frame, split in 3 planes (B, G, R)
+    @param stream The output state of the k-mean on the video
+    @param rng The random number generator, for the centroids which are not fixed
+*/
+void kmeanStreamInit(const vector<Mat>& BGR, kmean_stream& stream, RNG& rng) {
+    point centroids_old[K];
+    initialize_centroids(stream.centroids, centroids_old, rng);
+    kmeanStreamRecluster(BGR, stream);
+}
+
+// we blur only the pixels of the sample: the value of the pixel (i, j) of the frame blurred with the
+// separable kernel, with the same border as GaussianBlur (BORDER_REFLECT_101)
+static void blurredPixel(const Mat& frame, int i, int j, const float* kernel, int kernel_length,
+                         int& b, int& g, int& r) {
+    int radius = kernel_length / 2;
+    float sum_b = 0, sum_g = 0, sum_r = 0;
+    for (int di = 0; di < kernel_length; di++) {
+        const uchar* row = frame.ptr<uchar>(borderInterpolate(i + di - radius, frame.rows, BORDER_REFLECT_101));
+        float row_b = 0, row_g = 0, row_r = 0;
+        for (int dj = 0; dj < kernel_length; dj++) {
+            const uchar* pixel = row + 3 * borderInterpolate(j + dj - radius, frame.cols, BORDER_REFLECT_101);
+            row_b += kernel[dj] * pixel[0];
+            row_g += kernel[dj] * pixel[1];
+            row_r += kernel[dj] * pixel[2];
+        }
+        sum_b += kernel[di] * row_b;
+        sum_g += kernel[di] * row_g;
+        sum_r += kernel[di] * row_r;
+    }
+    b = cvRound(sum_b);
+    g = cvRound(sum_g);
+    r = cvRound(sum_r);
+}
+
+/**
+    Update the centroids with a new frame of the video, with a single pass on a random sample
+    of its pixels: each centroid moves towards the mean of its pixels in the sample,
+    with a learning rate which decreases with the number of samples it has already seen.
+    The frame is not blurred beforehand: only the pixels of the sample are blurred,
+    so the cost doesn't depend on the size of the frame
+
+    @param frame The new frame (BGR, CV_8UC3), not blurred
+    @param blur_kernel_length The length of the gaussian blur applied to the frames given to
+           kmeanStreamRecluster (odd number)
+    @param stream The state of the k-mean on the video, updated
+    @param rng The random number generator used to choose the pixels of the sample
+    @return true if the centroids or the classes changed too much since the last full k-mean:
+            the caller should then call kmeanStreamRecluster
+*/
+bool kmeanStreamUpdate(const Mat& frame, int blur_kernel_length, kmean_stream& stream, RNG& rng) {
+    CV_Assert(frame.type() == CV_8UC3);
+    int rows = frame.rows, cols = frame.cols;
+    Mat kernel = getGaussianKernel(blur_kernel_length, 0, CV_32F);
+    const float* kernel_values = kernel.ptr<float>(0);
+
+    class_sum sums[K];
+    memset(sums, 0, sizeof(sums));
+
+    // assignment of the pixels of the sample to the current centroids
+    for (int s = 0; s < STREAM_NB_SAMPLES; s++) {
+        int i = rng.uniform(0, rows);
+        int j = rng.uniform(0, cols);
+        int b, g, r;
+        blurredPixel(frame, i, j, kernel_values, blur_kernel_length, b, g, r);
+
+        int dist_min = INT_MAX;
+        int candidate = 0;
+        for (int k = 0; k < K; k++) {
+            int dist = squaredDistance(b, g, r, stream.centroids[k]);
+            if (dist < dist_min) {
+                dist_min = dist;
+                candidate = k;
+            }
+        }
+        addToSum(sums[candidate], b, g, r, 1);
+    }
+
+    stream.drift = 0;
+    stream.population_change = 0;
+    for (int k = 0; k < K; k++) {
+        // the older samples count less and less, so that the centroids follow slow changes
+        // of the light
+        stream.counts[k] = stream.counts[k] * STREAM_COUNTS_DECAY + sums[k].nb_pixels;
+
+        if (!stream.centroids[k].fixed && sums[k].nb_pixels > 0) {
+            float rate = sums[k].nb_pixels / stream.counts[k];
+            stream.B[k] += rate * ((float)sums[k].B / sums[k].nb_pixels - stream.B[k]);
+            stream.G[k] += rate * ((float)sums[k].G / sums[k].nb_pixels - stream.G[k]);
+            stream.R[k] += rate * ((float)sums[k].R / sums[k].nb_pixels - stream.R[k]);
+            stream.centroids[k].B = cvRound(stream.B[k]);
+            stream.centroids[k].G = cvRound(stream.G[k]);
+            stream.centroids[k].R = cvRound(stream.R[k]);
+        }
+
+        stream.drift = max(stream.drift, distance(stream.centroids[k], stream.reference[k]));
+        float population = (float)sums[k].nb_pixels / STREAM_NB_SAMPLES;
+        stream.population_change = max(stream.population_change, fabsf(population - stream.population[k]));
+    }
+
+    return stream.drift > STREAM_MAX_DRIFT || stream.population_change > STREAM_MAX_POPULATION_CHANGE;
+}
+
+
+// builds the color histogram of a stripe of rows, and adds it to the total histogram
+class HistogramBody : public ParallelLoopBody {
+public:
+    HistogramBody(const Mat& src, vector<class_sum>& histogram, mutex* histogram_mutex)
+        : src(src), histogram(histogram), histogram_mutex(histogram_mutex) {}
+
+    void operator()(const Range& range) const {
+        const int shift = 8 - HISTOGRAM_BITS;
+        vector<class_sum> stripe_histogram(histogram.size());  // filled with zeros
+
+        for (int i = range.start; i < range.end; i++) {
+            const Vec3b* row = src.ptr<Vec3b>(i);
+            for (int j = 0; j < src.cols; j++) {
+                int b = row[j][0], g = row[j][1], r = row[j][2];
+                class_sum& bin = stripe_histogram[((b >> shift) << (2*HISTOGRAM_BITS))
+                                                | ((g >> shift) << HISTOGRAM_BITS)
+                                                |  (r >> shift)];
+                bin.nb_pixels++;
+                bin.B += b;
+                bin.G += g;
+                bin.R += r;
+            }
+        }
+
+        lock_guard<mutex> lock(*histogram_mutex);
+        for (size_t i = 0; i < histogram.size(); i++) {
+            if (stripe_histogram[i].nb_pixels == 0)
+                continue;
+            histogram[i].nb_pixels += stripe_histogram[i].nb_pixels;
+            histogram[i].B += stripe_histogram[i].B;
+            histogram[i].G += stripe_histogram[i].G;
+            histogram[i].R += stripe_histogram[i].R;
+        }
+    }
+
+private:
+    const Mat& src;
+    vector<class_sum>& histogram;
+    mutex* histogram_mutex;
+};
+
+/**
+    Build the color histogram of the picture, with 2^HISTOGRAM_BITS bins for each color.
+    For each bin we keep the number of pixels and the sum of their values, so that
+    the k-mean on the histogram computes the same means as the k-mean on the pixels
+
+    @param src The picture (BGR)
+    @param bins The output list of the bins which contain at least one pixel
+*/
+void buildColorHistogram(const Mat& src, vector<class_sum>& bins) {
+    vector<class_sum> histogram(1 << (3*HISTOGRAM_BITS));
+    mutex histogram_mutex;
+
+    // one stripe per thread, because each stripe has its own histogram
+    parallel_for_(Range(0, src.rows), HistogramBody(src, histogram, &histogram_mutex), getNumThreads());
+
+    bins.clear();
+    for (size_t i = 0; i < histogram.size(); i++)
+        if (histogram[i].nb_pixels > 0)
+            bins.push_back(histogram[i]);
+}
+
+/**
+    The k-mean algorithm on the occupied bins of the color histogram: each bin is
+    a point (the mean color of its pixels) weighted by its number of pixels,
+    so the cost of an iteration doesn't depend on the resolution of the picture
+
+    @param bins The occupied bins, given by buildColorHistogram
+    @param centroids The initial centroids, and the output final centroids
+    @return The number of iterations
+*/
+int kmeanHistogram(const vector<class_sum>& bins, point* centroids) {
+    // the mean color of each bin
+    int nb_bins = (int)bins.size();
+    vector<float> bin_B(nb_bins), bin_G(nb_bins), bin_R(nb_bins);
+    for (int i = 0; i < nb_bins; i++) {
+        bin_B[i] = (float)bins[i].B / bins[i].nb_pixels;
+        bin_G[i] = (float)bins[i].G / bins[i].nb_pixels;
+        bin_R[i] = (float)bins[i].R / bins[i].nb_pixels;
+    }
+
+    point centroids_old[K];
+    memcpy(centroids_old, centroids, sizeof(centroids_old));
+    class_sum sums[K];
+    RNG rng(KMEAN_RNG_SEED);
+
+    int iteration_number = 0;
+    int gap;
+    do {
+        memset(sums, 0, sizeof(sums));
+        for (int i = 0; i < nb_bins; i++) {
+            float dist_min = FLT_MAX;
+            int candidate = 0;
+            for (int k = 0; k < K; k++) {
+                float db = bin_B[i] - centroids[k].B;
+                float dg = bin_G[i] - centroids[k].G;
+                float dr = bin_R[i] - centroids[k].R;
+                float dist = db*db + dg*dg + dr*dr;
+                if (dist < dist_min) {
+                    dist_min = dist;
+                    candidate = k;
+                }
+            }
+
+            // all the pixels of the bin go to the class of the bin
+            sums[candidate].nb_pixels += bins[i].nb_pixels;
+            sums[candidate].B += bins[i].B;
+            sums[candidate].G += bins[i].G;
+            sums[candidate].R += bins[i].R;
+        }
+
+        gap = update_centroids(centroids, centroids_old, sums, rng);
+        iteration_number++;
+    } while (gap > 1);
+
+    return iteration_number;
+}
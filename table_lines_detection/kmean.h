@@ -0,0 +1,106 @@
+#ifndef KMEAN_H
+#define KMEAN_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <iostream>
+#include <stdint.h>
+
+using namespace cv;
+using namespace std;
+
+// number of clusters to split the set by
+// we select 4 because it is likely to have 4 main colors:
+// - the main table color (blue / green)
+// - the color of the lines (white)
+// - the color of the ground
+// - the color of the black edges of the pictures, which come from undistortion algorithm
+const int K = 4;
+
+// we predefine the centroids (if possible) for better results of the k-mean algorithm
+// format: {R,G,B}
+#define CENTROID_LINE {192,188,158} // white line
+#define CENTROID_EDGE {0,0,0}       // black edges
+#define CENTROID_TABLE {35,43,46}      // green / blue
+
+// we give a number to some k-mean class
+#define LINE_CLASS_NUMBER  0
+#define TABLE_CLASS_NUMBER 1
+#define EDGE_CLASS_NUMBER  2
+
+// Nota bene: a pixel can be seen as a point in a 3-dimensional space
+typedef struct {
+    int R;
+    int G;
+    int B;
+    bool fixed; // used only for centroids
+} point;
+
+// the number of pixels in a k-mean class, and the sum of their values for each color
+// (64 bits, because the sums overflow 32 bits on big pictures)
+typedef struct {
+    int64_t nb_pixels;
+    int64_t R;
+    int64_t G;
+    int64_t B;
+} class_sum;
+
+// seed of the random number generator used for the centroids which are not fixed
+// (always the same, so that two runs on the same picture give the same result)
+const uint64 KMEAN_RNG_SEED = 12345;
+
+// the bounds of the accelerated k-mean, for each pixel (CV_32F)
+typedef struct {
+    Mat upper;  // upper bound of the distance to the centroid of the class of the pixel
+    Mat lower;  // lower bound of the distance to all the other centroids
+} kmean_bounds;
+
+// the k-mean on a video: the centroids of a frame are the initial centroids of the next frame,
+// and they are updated with a random sample of the pixels (mini-batch), except when
+// they have moved too much since the last full k-mean (then we run a full k-mean)
+const int STREAM_NB_SAMPLES = 4096;            // number of pixels in the sample of each frame
+const float STREAM_COUNTS_DECAY = 0.9;         // weight of the previous samples at each frame
+const float STREAM_MAX_DRIFT = 10;             // max distance moved by a centroid since the last full k-mean
+const float STREAM_MAX_POPULATION_CHANGE = 0.05;  // max change of the share of the pixels in a class
+
+typedef struct {
+    point centroids[K];
+    float B[K], G[K], R[K];   // the centroids with a sub-unit precision, for the mini-batch updates
+    float counts[K];          // number of samples seen by each centroid (decayed at each frame)
+    point reference[K];       // the centroids given by the last full k-mean
+    float population[K];      // the share of the pixels in each class after the last full k-mean
+    float drift;              // max distance between the centroids and the reference centroids
+    float population_change;  // max difference between the shares of the classes in the sample,
+                              // and the shares after the last full k-mean
+} kmean_stream;
+
+// number of bits kept for each color in the color histogram (32 bins per color)
+const int HISTOGRAM_BITS = 5;
+
+
+void initialize_centroid_with_rand(point* c, RNG& rng); // initialize centroid with random values
+void initialize_fixed_centroid_with_tab(point* c, point* c_old, int* values);
+float distance(point vect1, point vect2); // compute distance between 3D vectors
+
+void initialize_centroids(point* centroids, point* centroids_old, RNG& rng);
+int update_centroids(point* centroids, point* centroids_old, const class_sum* sums, RNG& rng);
+
+void kmeanAssign(const vector<Mat>& BGR, const point* centroids, Mat& kmean_class_number, class_sum* sums);
+int kmeanPixels(const vector<Mat>& BGR, point* centroids, Mat& kmean_class_number);
+
+void kmeanAssignBounds(const vector<Mat>& BGR, const point* centroids, Mat& kmean_class_number,
+                       kmean_bounds& bounds, class_sum* sums);
+int64_t kmeanUpdateBounds(const vector<Mat>& BGR, const point* centroids_previous, const point* centroids,
+                          Mat& kmean_class_number, kmean_bounds& bounds, class_sum* sums);
+int kmeanAccelerated(const vector<Mat>& BGR, point* centroids, Mat& kmean_class_number,
+                     class_sum* class_sums = NULL);
+
+void kmeanStreamRecluster(const vector<Mat>& BGR, kmean_stream& stream);
+void kmeanStreamInit(const vector<Mat>& BGR, kmean_stream& stream, RNG& rng);
+bool kmeanStreamUpdate(const Mat& frame, int blur_kernel_length, kmean_stream& stream, RNG& rng);
+
+void buildColorHistogram(const Mat& src, vector<class_sum>& bins);
+int kmeanHistogram(const vector<class_sum>& bins, point* centroids);
+
+
+#endif
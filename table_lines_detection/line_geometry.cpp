@@ -0,0 +1,254 @@
+#include "line_geometry.h"
+
+#include <math.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+
+// the numbers of the four sets of table lines, computed by classifySegments
+// (0 for the lines which are in none of the sets)
+#define GROUP_NONE             0
+#define GROUP_HORIZONTAL_UP    1
+#define GROUP_HORIZONTAL_DOWN  2
+#define GROUP_VERTICAL_LEFT    3
+#define GROUP_VERTICAL_RIGHT   4
+
+
+/**
+    Convert segments given by the Hough transform to a structure of arrays
+
+    @param lines The segments (x1, y1, x2, y2)
+    @param segments The output segments
+*/
+void toSegments(const vector<Vec4i>& lines, segments_soa& segments) {
+    size_t n = lines.size();
+    segments.x1.resize(n);
+    segments.y1.resize(n);
+    segments.x2.resize(n);
+    segments.y2.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        segments.x1[i] = (float)lines[i][0];
+        segments.y1[i] = (float)lines[i][1];
+        segments.x2[i] = (float)lines[i][2];
+        segments.y2[i] = (float)lines[i][3];
+    }
+}
+
+/**
+    Sort the segments in the four sets of table lines: a segment is horizontal (or vertical)
+    if its angle with the horizontal (or vertical) direction is less than LINE_MAX_ANGLE_DEGREES,
+    and it's in the upper (or left) set if its two ends are in the upper (or left) half of the picture.
+    The angle is not computed: we compare |dy| with tan(max angle) * |dx|, for 4 segments at a time
+
+    @param lines The segments given by the Hough transform
+    @param image_size The size of the picture
+    @param groups The output segments, in four sets
+*/
+void classifySegments(const vector<Vec4i>& lines, Size image_size, line_groups& groups) {
+    segments_soa segments;
+    toSegments(lines, segments);
+
+    int n = (int)lines.size();
+    vector<int> group_numbers(n);
+    const float tan_max = (float)tan(LINE_MAX_ANGLE_DEGREES * CV_PI / 180);
+    const float half_width  = (float)(image_size.width / 2);
+    const float half_height = (float)(image_size.height / 2);
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 v_tan_max = _mm_set1_ps(tan_max);
+    const __m128 v_half_width = _mm_set1_ps(half_width);
+    const __m128 v_half_height = _mm_set1_ps(half_height);
+
+    for (; i <= n - 4; i += 4) {
+        __m128 x1 = _mm_loadu_ps(&segments.x1[i]);
+        __m128 y1 = _mm_loadu_ps(&segments.y1[i]);
+        __m128 x2 = _mm_loadu_ps(&segments.x2[i]);
+        __m128 y2 = _mm_loadu_ps(&segments.y2[i]);
+        __m128 dx = _mm_andnot_ps(sign_mask, _mm_sub_ps(x2, x1));  // |x2 - x1|
+        __m128 dy = _mm_andnot_ps(sign_mask, _mm_sub_ps(y2, y1));
+
+        __m128 horizontal = _mm_cmplt_ps(dy, _mm_mul_ps(v_tan_max, dx));
+        __m128 vertical   = _mm_cmplt_ps(dx, _mm_mul_ps(v_tan_max, dy));
+        __m128 up    = _mm_and_ps(_mm_cmplt_ps(y1, v_half_height), _mm_cmplt_ps(y2, v_half_height));
+        __m128 down  = _mm_and_ps(_mm_cmpgt_ps(y1, v_half_height), _mm_cmpgt_ps(y2, v_half_height));
+        __m128 left  = _mm_and_ps(_mm_cmplt_ps(x1, v_half_width), _mm_cmplt_ps(x2, v_half_width));
+        __m128 right = _mm_and_ps(_mm_cmpgt_ps(x1, v_half_width), _mm_cmpgt_ps(x2, v_half_width));
+
+        // at most one of the four masks is set for each segment: we select its number
+        __m128i number = _mm_or_si128(
+            _mm_or_si128(
+                _mm_and_si128(_mm_castps_si128(_mm_and_ps(horizontal, up)),   _mm_set1_epi32(GROUP_HORIZONTAL_UP)),
+                _mm_and_si128(_mm_castps_si128(_mm_and_ps(horizontal, down)), _mm_set1_epi32(GROUP_HORIZONTAL_DOWN))),
+            _mm_or_si128(
+                _mm_and_si128(_mm_castps_si128(_mm_and_ps(vertical, left)),   _mm_set1_epi32(GROUP_VERTICAL_LEFT)),
+                _mm_and_si128(_mm_castps_si128(_mm_and_ps(vertical, right)),  _mm_set1_epi32(GROUP_VERTICAL_RIGHT))));
+        _mm_storeu_si128((__m128i*)&group_numbers[i], number);
+    }
+#endif
+
+    // remaining segments (or all the segments, without SSE2)
+    for (; i < n; i++) {
+        float dx = fabsf(segments.x2[i] - segments.x1[i]);
+        float dy = fabsf(segments.y2[i] - segments.y1[i]);
+        int number = GROUP_NONE;
+        if (dy < tan_max * dx) {
+            if (segments.y1[i] < half_height && segments.y2[i] < half_height)
+                number = GROUP_HORIZONTAL_UP;
+            else if (segments.y1[i] > half_height && segments.y2[i] > half_height)
+                number = GROUP_HORIZONTAL_DOWN;
+        }
+        else if (dx < tan_max * dy) {
+            if (segments.x1[i] < half_width && segments.x2[i] < half_width)
+                number = GROUP_VERTICAL_LEFT;
+            else if (segments.x1[i] > half_width && segments.x2[i] > half_width)
+                number = GROUP_VERTICAL_RIGHT;
+        }
+        group_numbers[i] = number;
+    }
+
+    groups.horizontal_up.clear();
+    groups.horizontal_down.clear();
+    groups.vertical_left.clear();
+    groups.vertical_right.clear();
+    for (i = 0; i < n; i++) {
+        switch (group_numbers[i]) {
+            case GROUP_HORIZONTAL_UP:   groups.horizontal_up.push_back(lines[i]);   break;
+            case GROUP_HORIZONTAL_DOWN: groups.horizontal_down.push_back(lines[i]); break;
+            case GROUP_VERTICAL_LEFT:   groups.vertical_left.push_back(lines[i]);   break;
+            case GROUP_VERTICAL_RIGHT:  groups.vertical_right.push_back(lines[i]);  break;
+        }
+    }
+}
+
+/**
+    Compute the intersections of the lines of all the segments of a set with the lines of
+    all the segments of another set (the lines are infinite, like intersection_point
+    of hough-transform.cpp). Each segment of the first set is intersected with 4 segments
+    of the second set at a time, and the parallel lines are skipped
+
+    @param segments1 The first set of segments
+    @param segments2 The second set of segments
+    @param points The output intersections, in the order of the segments of the first set,
+                  then of the second set
+*/
+void intersectSegments(const segments_soa& segments1, const segments_soa& segments2, points_soa& points) {
+    int n1 = (int)segments1.x1.size();
+    int n2 = (int)segments2.x1.size();
+    points.x.clear();
+    points.y.clear();
+    const float epsilon = 1e-8f;
+
+    // the direction vectors of the segments of the second set, computed once
+    vector<float> dir2_x(n2), dir2_y(n2);
+    for (int j = 0; j < n2; j++) {
+        dir2_x[j] = segments2.x2[j] - segments2.x1[j];
+        dir2_y[j] = segments2.y2[j] - segments2.y1[j];
+    }
+
+    for (int i = 0; i < n1; i++) {
+        float ori1_x = segments1.x1[i], ori1_y = segments1.y1[i];
+        float dir1_x = segments1.x2[i] - ori1_x;
+        float dir1_y = segments1.y2[i] - ori1_y;
+        int j = 0;
+
+#if defined(__SSE2__)
+        const __m128 sign_mask = _mm_set1_ps(-0.0f);
+        const __m128 v_epsilon = _mm_set1_ps(epsilon);
+        __m128 v_ori1_x = _mm_set1_ps(ori1_x), v_ori1_y = _mm_set1_ps(ori1_y);
+        __m128 v_dir1_x = _mm_set1_ps(dir1_x), v_dir1_y = _mm_set1_ps(dir1_y);
+
+        for (; j <= n2 - 4; j += 4) {
+            __m128 d2x = _mm_loadu_ps(&dir2_x[j]);
+            __m128 d2y = _mm_loadu_ps(&dir2_y[j]);
+            __m128 x = _mm_sub_ps(_mm_loadu_ps(&segments2.x1[j]), v_ori1_x);  // vector from ori1 to ori2
+            __m128 y = _mm_sub_ps(_mm_loadu_ps(&segments2.y1[j]), v_ori1_y);
+
+            // cross product of the direction vectors: 0 if the lines are parallel
+            __m128 cross = _mm_sub_ps(_mm_mul_ps(v_dir1_x, d2y), _mm_mul_ps(v_dir1_y, d2x));
+            int not_parallel = _mm_movemask_ps(_mm_cmpge_ps(_mm_andnot_ps(sign_mask, cross), v_epsilon));
+            if (not_parallel == 0)
+                continue;
+
+            __m128 t1 = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(x, d2y), _mm_mul_ps(y, d2x)), cross);
+            float res_x[4], res_y[4];
+            _mm_storeu_ps(res_x, _mm_add_ps(v_ori1_x, _mm_mul_ps(v_dir1_x, t1)));
+            _mm_storeu_ps(res_y, _mm_add_ps(v_ori1_y, _mm_mul_ps(v_dir1_y, t1)));
+
+            for (int k = 0; k < 4; k++) {
+                if (not_parallel & (1 << k)) {
+                    points.x.push_back(res_x[k]);
+                    points.y.push_back(res_y[k]);
+                }
+            }
+        }
+#endif
+
+        // remaining segments (or all the segments, without SSE2)
+        for (; j < n2; j++) {
+            float x = segments2.x1[j] - ori1_x;
+            float y = segments2.y1[j] - ori1_y;
+            float cross = dir1_x * dir2_y[j] - dir1_y * dir2_x[j];
+            if (fabsf(cross) < epsilon)
+                continue;
+            float t1 = (x * dir2_y[j] - y * dir2_x[j]) / cross;
+            points.x.push_back(ori1_x + dir1_x * t1);
+            points.y.push_back(ori1_y + dir1_y * t1);
+        }
+    }
+}
+
+/**
+    Find the point which is the farthest from a given point (we compare the squared distances)
+
+    @param points The points
+    @param center The reference point
+    @param farthest The output farthest point (the first one, in case of equality)
+    @return false if there are no points
+*/
+bool farthestPoint(const points_soa& points, Point2f center, Point2f& farthest) {
+    int n = (int)points.x.size();
+    if (n == 0)
+        return false;
+
+    int farthest_index = 0;
+    float dist_max = -1;
+    for (int i = 0; i < n; i++) {
+        float dx = points.x[i] - center.x;
+        float dy = points.y[i] - center.y;
+        float dist = dx*dx + dy*dy;
+        if (dist > dist_max) {
+            dist_max = dist;
+            farthest_index = i;
+        }
+    }
+
+    farthest = Point2f(points.x[farthest_index], points.y[farthest_index]);
+    return true;
+}
+
+/**
+    Write the corners of the table to a YAML file, with the size of the picture, so they can
+    be scaled to another resolution (the ball tracking restricts its search to the table with them)
+
+    @param filename The output filename
+    @param corners The 4 corners: left up, right up, right down, left down
+    @param image_size The size of the picture where the corners were found
+    @return false if the file could not be written
+*/
+bool saveTableCorners(const string& filename, const vector<Point2f>& corners, Size image_size) {
+    FileStorage fs(filename, FileStorage::WRITE);
+    if (!fs.isOpened())
+        return false;
+
+    fs << "Image_Width" << image_size.width;
+    fs << "Image_Height" << image_size.height;
+    fs << "Table_Corners" << corners;
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef LINE_GEOMETRY_H
+#define LINE_GEOMETRY_H
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+// maximum angle between a table line and the horizontal or vertical direction
+const float LINE_MAX_ANGLE_DEGREES = 5;
+
+// the segments found by the Hough transform, in four sets,
+// based on the coordinates of the end of the segments, and their angle
+typedef struct {
+    vector<Vec4i> horizontal_up;
+    vector<Vec4i> horizontal_down;
+    vector<Vec4i> vertical_left;
+    vector<Vec4i> vertical_right;
+} line_groups;
+
+// segments stored as a structure of arrays: the coordinates of the ends of all the segments
+// are in 4 arrays, so that the computations on many segments can be vectorized
+typedef struct {
+    vector<float> x1, y1, x2, y2;
+} segments_soa;
+
+// points stored as a structure of arrays
+typedef struct {
+    vector<float> x, y;
+} points_soa;
+
+
+void toSegments(const vector<Vec4i>& lines, segments_soa& segments);
+void classifySegments(const vector<Vec4i>& lines, Size image_size, line_groups& groups);
+void intersectSegments(const segments_soa& segments1, const segments_soa& segments2, points_soa& points);
+bool farthestPoint(const points_soa& points, Point2f center, Point2f& farthest);
+bool saveTableCorners(const string& filename, const vector<Point2f>& corners, Size image_size);
+
+
+#endif
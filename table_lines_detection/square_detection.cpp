@@ -0,0 +1,339 @@
+// The "Square Detector" (from OpenCV example directory)
+
+#include "square_detection.h"
+#include "component_tree.h"
+
+#include <math.h>
+#include <atomic>
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+
+// helper function:
+// finds a cosine of angle between vectors
+// pt0->pt1 and pt0->pt2
+static double angle( Point pt1, Point pt2, Point pt0 )
+{
+    double dx1 = pt1.x - pt0.x;
+    double dy1 = pt1.y - pt0.y;
+    double dx2 = pt2.x - pt0.x;
+    double dy2 = pt2.y - pt0.y;
+    return (dx1*dx2 + dy1*dy2)/sqrt((dx1*dx1 + dy1*dy1)*(dx2*dx2 + dy2*dy2) + 1e-10);
+}
+
+// the length of the segment p1 p2
+static double sideLength( Point p1, Point p2 )
+{
+    double dx = p1.x - p2.x;
+    double dy = p1.y - p2.y;
+    return sqrt(dx*dx + dy*dy);
+}
+
+/**
+    Check if a square found by findSquares is the one we search for
+
+    @param square The 4 vertices of the square
+    @param target The area and the aspect ratio of the square we search for
+    @return true if the square matches
+*/
+bool squareMatches(const vector<Point>& square, const square_target& target)
+{
+    double area = fabs(contourArea(Mat(square)));
+    if( area < target.min_area || area > target.max_area )
+        return false;
+
+    // mean length of the two pairs of opposite sides
+    double sides1 = (sideLength(square[0], square[1]) + sideLength(square[2], square[3])) / 2;
+    double sides2 = (sideLength(square[1], square[2]) + sideLength(square[3], square[0])) / 2;
+    double aspect_ratio = MAX(sides1, sides2) / (MIN(sides1, sides2) + 1e-10);
+    return fabs(aspect_ratio - target.aspect_ratio) <= target.aspect_tolerance;
+}
+
+
+// checks if a contour is a square: 4 vertices after approximation, large enough and convex,
+// with angles of ~90 degrees
+static bool isSquare( const vector<Point>& contour, vector<Point>& approx )
+{
+    // approximate contour with accuracy proportional
+    // to the contour perimeter
+    approxPolyDP(Mat(contour), approx, arcLength(Mat(contour), true)*0.02, true);
+
+    // square contours should have 4 vertices after approximation
+    // relatively large area (to filter out noisy contours)
+    // and be convex.
+    // Note: absolute value of an area is used because
+    // area may be positive or negative - in accordance with the
+    // contour orientation
+    if( approx.size() != 4 ||
+        fabs(contourArea(Mat(approx))) <= SQUARES_MIN_AREA ||
+        !isContourConvex(Mat(approx)) )
+        return false;
+
+    double maxCosine = 0;
+
+    for( int j = 2; j < 5; j++ )
+    {
+        // find the maximum cosine of the angle between joint edges
+        double cosine = fabs(angle(approx[j%4], approx[j-2], approx[j-1]));
+        maxCosine = MAX(maxCosine, cosine);
+    }
+
+    // if cosines of all angles are small
+    // (all angles are ~90 degree) then it is a quadrange
+    return maxCosine < 0.3;
+}
+
+
+// with the component trees, each color plane has 2 trees: the tree of the plane (the white
+// areas of the thresholded plane) and the tree of the inverted plane (the black areas)
+typedef struct {
+    int tree;  // index of the tree: 2 * plane for the white areas, 2 * plane + 1 for the black areas
+    int node;
+} tree_component;
+
+// the components of the plane thresholded by a pass (not the first one, which uses Canny):
+// the white areas (gray >= level) and the black areas which are not on the border of the
+// image (the holes, whose contours are also returned by findContours)
+static void passComponents( vector<ComponentTree>& trees, int pass, vector<tree_component>& components )
+{
+    int c = pass / SQUARES_NB_LEVELS;
+    int level = (pass % SQUARES_NB_LEVELS + 1)*255/SQUARES_NB_LEVELS;
+    // the area of the approximated contour can be a bit larger than the number of pixels
+    int min_area = SQUARES_MIN_AREA / 2;
+
+    components.clear();
+    vector<int> nodes;
+    trees[2*c].components(level - 1, nodes, min_area);
+    for( size_t i = 0; i < nodes.size(); i++ )
+    {
+        tree_component component = {2*c, nodes[i]};
+        components.push_back(component);
+    }
+
+    ComponentTree& inverted = trees[2*c + 1];
+    inverted.components(255 - level, nodes, min_area);
+    for( size_t i = 0; i < nodes.size(); i++ )
+    {
+        Rect bbox = inverted.node(nodes[i]).bbox;
+        Size size = inverted.node(0).bbox.size();  // the root is the whole image
+        if( bbox.x == 0 || bbox.y == 0 || bbox.br().x == size.width || bbox.br().y == size.height )
+            continue;
+        tree_component component = {2*c + 1, nodes[i]};
+        components.push_back(component);
+    }
+}
+
+// builds the component tree of each color plane and of each inverted color plane
+class TreesBody : public ParallelLoopBody {
+public:
+    TreesBody(const vector<Mat>& planes, vector<ComponentTree>& trees) : planes(planes), trees(trees) {}
+
+    void operator()(const Range& range) const {
+        for( int t = range.start; t < range.end; t++ )
+        {
+            const Mat& plane = planes[t / 2];
+            if( t % 2 == 0 )
+                trees[t].build(plane);
+            else
+            {
+                Mat inverted;
+                bitwise_not(plane, inverted);
+                trees[t].build(inverted);
+            }
+        }
+    }
+
+private:
+    const vector<Mat>& planes;
+    vector<ComponentTree>& trees;
+};
+
+// computes the contours of a list of components (each component is in the list once,
+// so each contour is written by a single thread)
+class TreeContoursBody : public ParallelLoopBody {
+public:
+    TreeContoursBody(const vector<tree_component>& components, vector<ComponentTree>& trees)
+        : components(components), trees(trees) {}
+
+    void operator()(const Range& range) const {
+        for( int i = range.start; i < range.end; i++ )
+            trees[components[i].tree].contour(components[i].node);
+    }
+
+private:
+    const vector<tree_component>& components;
+    vector<ComponentTree>& trees;
+};
+
+#ifdef SQUARES_COMPONENT_TREE
+static bool componentLess( const tree_component& a, const tree_component& b )
+{
+    return a.tree < b.tree || (a.tree == b.tree && a.node < b.node);
+}
+
+static bool componentEqual( const tree_component& a, const tree_component& b )
+{
+    return a.tree == b.tree && a.node == b.node;
+}
+#endif
+
+
+// one pass of the square detection (one color plane and one threshold level)
+// for each index of the range
+class SquarePassesBody : public ParallelLoopBody {
+public:
+    SquarePassesBody(const vector<Mat>& planes, vector<ComponentTree>& trees, const square_target* target,
+                     vector<vector<vector<Point> > >& pass_squares, atomic<int>& first_match)
+        : planes(planes), trees(trees), target(target), pass_squares(pass_squares), first_match(first_match) {}
+
+    void operator()(const Range& range) const {
+        // the buffers are local to the stripe, and reused by all its passes
+        Mat gray;
+        vector<vector<Point> > contours;
+        vector<tree_component> components;
+        vector<Point> approx;
+
+        for( int pass = range.start; pass < range.end; pass++ )
+        {
+            // a pass after a pass which has already found the target would be thrown away
+            if( pass > first_match.load() )
+                continue;
+
+            const Mat& gray0 = planes[pass / SQUARES_NB_LEVELS];
+            int l = pass % SQUARES_NB_LEVELS;
+            vector<vector<Point> >& squares = pass_squares[pass];
+            bool found = false;
+
+            // hack: use Canny instead of zero threshold level.
+            // Canny helps to catch squares with gradient shading
+            if( l == 0 )
+            {
+                // apply Canny. Take the upper threshold from slider
+                // and set the lower to 0 (which forces edges merging)
+                Canny(gray0, gray, 0, SQUARES_CANNY_THRESHOLD, 5);
+                // dilate canny output to remove potential
+                // holes between edge segments
+                dilate(gray, gray, Mat(), Point(-1,-1));
+
+                // find contours and store them all as a list
+                findContours(gray, contours, CV_RETR_LIST, CV_CHAIN_APPROX_SIMPLE);
+            }
+            else if( !trees.empty() )
+            {
+                // the contours of the components were computed before the passes
+                passComponents(trees, pass, components);
+                contours.resize(components.size());
+                for( size_t i = 0; i < components.size(); i++ )
+                    contours[i] = trees[components[i].tree].contour(components[i].node);
+            }
+            else
+            {
+                // apply threshold if l!=0:
+                //     tgray(x,y) = gray(x,y) < (l+1)*255/SQUARES_NB_LEVELS ? 255 : 0
+                gray = gray0 >= (l+1)*255/SQUARES_NB_LEVELS;
+
+                // find contours and store them all as a list
+                findContours(gray, contours, CV_RETR_LIST, CV_CHAIN_APPROX_SIMPLE);
+            }
+
+            // test each contour
+            for( size_t i = 0; i < contours.size(); i++ )
+            {
+                if( isSquare(contours[i], approx) )
+                {
+                    squares.push_back(approx);
+                    if( target != NULL && squareMatches(approx, *target) )
+                        found = true;
+                }
+            }
+
+            // we keep the lowest index of the passes which found the target
+            if( found )
+            {
+                int current = first_match.load();
+                while( pass < current && !first_match.compare_exchange_weak(current, pass) ) {}
+            }
+        }
+    }
+
+private:
+    const vector<Mat>& planes;                         // the filtered color planes, read only
+    vector<ComponentTree>& trees;                      // empty: the planes are thresholded by each pass
+    const square_target* target;                       // NULL: no early exit
+    vector<vector<vector<Point> > >& pass_squares;     // the squares found by each pass
+    atomic<int>& first_match;                          // lowest index of a pass which found the target
+};
+
+/**
+    Find the squares of the image: each color plane is thresholded at several levels
+    (SQUARES_NB_PASSES passes), and the passes run in parallel on the same filtered image.
+    With SQUARES_COMPONENT_TREE defined, the contours of the thresholded planes are taken
+    from the component trees of the planes instead of thresholding each level.
+    The squares are returned in the order of the passes, so the result doesn't depend
+    on the number of threads.
+
+    If a target is given, the search stops after the first pass (in the order of the passes)
+    which finds a square matching the target: the passes after it are skipped or thrown away,
+    so the result is still the same whatever the scheduling
+
+    @param image The image (BGR)
+    @param squares The output squares (4 vertices each)
+    @param target The square to search for, or NULL to run all the passes
+*/
+void findSquares( const Mat& image, vector<vector<Point> >& squares, const square_target* target )
+{
+    squares.clear();
+
+    Mat pyr, timg;
+
+    // down-scale and upscale the image to filter out the noise
+    pyrDown(image, pyr, Size(image.cols/2, image.rows/2));
+    pyrUp(pyr, timg, image.size());
+
+    // the color planes are split once for all the passes
+    vector<Mat> planes;
+    split(timg, planes);
+
+    vector<ComponentTree> trees;
+    #ifdef SQUARES_COMPONENT_TREE
+        // the thresholded planes are read from the component trees, built once for all the levels
+        trees.resize(6);
+        parallel_for_(Range(0, 6), TreesBody(planes, trees));
+
+        // the same component is often found at several levels: its contour is computed only once
+        vector<tree_component> all_components, components;
+        for( int pass = 0; pass < SQUARES_NB_PASSES; pass++ )
+        {
+            if( pass % SQUARES_NB_LEVELS == 0 )
+                continue;
+            passComponents(trees, pass, components);
+            all_components.insert(all_components.end(), components.begin(), components.end());
+        }
+        sort(all_components.begin(), all_components.end(), componentLess);
+        all_components.erase(unique(all_components.begin(), all_components.end(), componentEqual), all_components.end());
+        parallel_for_(Range(0, (int)all_components.size()), TreeContoursBody(all_components, trees));
+    #endif
+
+    vector<vector<vector<Point> > > pass_squares(SQUARES_NB_PASSES);
+    atomic<int> first_match(SQUARES_NB_PASSES);
+    parallel_for_(Range(0, SQUARES_NB_PASSES), SquarePassesBody(planes, trees, target, pass_squares, first_match));
+
+    // the passes after the first match (if any) are not kept
+    int last_pass = MIN(first_match.load(), SQUARES_NB_PASSES - 1);
+    for( int pass = 0; pass <= last_pass; pass++ )
+        squares.insert(squares.end(), pass_squares[pass].begin(), pass_squares[pass].end());
+}
+
+
+// the function draws all the squares in the image
+void drawSquares( Mat& image, const vector<vector<Point> >& squares )
+{
+    for( size_t i = 0; i < squares.size(); i++ )
+    {
+        const Point* p = &squares[i][0];
+        int n = (int)squares[i].size();
+        polylines(image, &p, &n, 1, true, Scalar(0,255,0), 3, CV_AA);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef SQUARE_DETECTION_H
+#define SQUARE_DETECTION_H
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+// upper threshold of the Canny edge detector, and number of threshold levels
+// tried on each color plane
+const int SQUARES_CANNY_THRESHOLD = 50;
+const int SQUARES_NB_LEVELS = 11;
+// each color plane is tried with each threshold level: these passes run in parallel
+const int SQUARES_NB_PASSES = 3 * SQUARES_NB_LEVELS;
+// minimum area of a square (pixels)
+const int SQUARES_MIN_AREA = 1000;
+
+// to get the contours at each threshold level from the component trees of the color planes
+// (built once) instead of thresholding the planes at each level, define "SQUARES_COMPONENT_TREE"
+// #define SQUARES_COMPONENT_TREE
+
+// the square we search for, to stop the search as soon as it is found
+typedef struct {
+    double min_area, max_area;  // area of the square (pixels)
+    double aspect_ratio;        // mean length of the long sides / mean length of the short sides
+    double aspect_tolerance;    // maximum difference with the aspect ratio
+} square_target;
+
+
+bool squareMatches(const vector<Point>& square, const square_target& target);
+void findSquares(const Mat& image, vector<vector<Point> >& squares, const square_target* target = NULL);
+void drawSquares(Mat& image, const vector<vector<Point> >& squares);
+
+
+#endif
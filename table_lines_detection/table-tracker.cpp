@@ -0,0 +1,93 @@
+#include <opencv/cv.h>
+#include <opencv/highgui.h>
+#include <iostream>
+#include <string.h>
+
+#include "table_tracker.h"
+#include "line_geometry.h"
+
+using namespace cv;
+using namespace std;
+
+// to display the table found on each frame, define "SHOW_WINDOWS"
+#define SHOW_WINDOWS
+
+
+// returns the elapsed time in milliseconds since 'start' (given by getTickCount)
+static double elapsedMs(int64 start) {
+    return (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
+
+int main(int argc, char** argv) {
+    // we get the filename of the video file to use
+    if (argc == 1) {
+        cerr << "Usage: " << argv[0] << " <video> [hough|squares] [table_corners.yml]" << endl;
+        exit(1);
+    }
+    const string videofilename = argv[1];
+    TableDetector detector = (argc >= 3 && strcmp(argv[2], "squares") == 0) ? DETECTOR_SQUARES : DETECTOR_HOUGH;
+
+    VideoCapture capture(videofilename);
+    if (!capture.isOpened()) {
+        cerr << "Error when reading video file" << endl;
+        exit(1);
+    }
+
+    Mat frame;
+    Size frame_size;
+    TableTracker tracker(detector);
+    int nb_frames = 0, nb_found = 0;
+    double time_total = 0;
+
+    while (true) {
+        capture >> frame;
+        if (frame.empty())
+            break;
+        frame_size = frame.size();
+
+        int64 start = getTickCount();
+        if (tracker.processFrame(frame))
+            nb_found++;
+        time_total += elapsedMs(start);
+        nb_frames++;
+
+        #ifdef SHOW_WINDOWS
+            // the geometry is read like the other stages would do it, without lock
+            shared_ptr<const TableGeometry> geometry = tracker.geometry();
+            if (geometry) {
+                for (int c = 0; c < 4; c++)
+                    line(frame, geometry->corners[c], geometry->corners[(c + 1) % 4], Scalar(0, 0, 255), 2, CV_AA);
+            }
+            imshow("table tracker", frame);
+            if (waitKey(1) == 27)  // escape
+                break;
+        #endif
+    }
+
+    if (nb_frames == 0) {
+        cerr << "The video has no frames" << endl;
+        exit(1);
+    }
+
+    shared_ptr<const TableGeometry> geometry = tracker.geometry();
+    if (geometry) {
+        cout << "table corners (detected at frame " << geometry->frame_number << "):";
+        for (int c = 0; c < 4; c++)
+            cout << " " << geometry->corners[c];
+        cout << endl;
+
+        // the corners of the last detection can be written to a file, for the ball tracking
+        if (argc >= 4) {
+            vector<Point2f> corners(geometry->corners, geometry->corners + 4);
+            if (saveTableCorners(argv[3], corners, frame_size))
+                cout << "table corners written to " << argv[3] << endl;
+            else
+                cerr << "Error when writing table corners file " << argv[3] << endl;
+        }
+    }
+    cout << nb_frames << " frames, table found on " << nb_found << " frames, "
+         << tracker.nb_detections << " full detections" << endl;
+    cout << "mean time: " << time_total / nb_frames << " ms per frame" << endl;
+
+    return 0;
+}
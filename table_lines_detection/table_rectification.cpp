@@ -0,0 +1,138 @@
+#include "table_rectification.h"
+
+#include <math.h>
+#include <float.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+
+/**
+    Compute the homography from the picture to the table: the corners of the table are
+    sent to (0, 0), (TABLE_LENGTH, 0), (TABLE_LENGTH, TABLE_WIDTH) and (0, TABLE_WIDTH),
+    so the coordinates on the table are in cm
+
+    @param corners The 4 corners of the table: left up, right up, right down, left down
+    @param homography The output homography (3x3, CV_64F)
+*/
+void tableHomography(const Point2f* corners, Mat& homography) {
+    Point2f table_corners[4] = { Point2f(0, 0), Point2f(TABLE_LENGTH, 0),
+                                 Point2f(TABLE_LENGTH, TABLE_WIDTH), Point2f(0, TABLE_WIDTH) };
+    homography = getPerspectiveTransform(corners, table_corners);
+}
+
+// size of the view of the table from above (pixels)
+Size rectifiedSize() {
+    return Size(cvRound((TABLE_LENGTH + 2 * RECTIFIED_MARGIN_CM) * RECTIFIED_PIXELS_PER_CM),
+                cvRound((TABLE_WIDTH  + 2 * RECTIFIED_MARGIN_CM) * RECTIFIED_PIXELS_PER_CM));
+}
+
+/**
+    Compute the remap tables of the view of the table from above: each pixel of the view
+    gets the coordinates of the pixel to sample in the picture. The tables are computed
+    once for a position of the camera, and converted to fixed-point, so each frame is then
+    rectified by a single remap
+
+    @param homography The homography from the picture to the table (cm)
+    @param map1 The output first remap table (fixed-point coordinates)
+    @param map2 The output second remap table (interpolation coefficients)
+*/
+void initRectificationMaps(const Mat& homography, Mat& map1, Mat& map2) {
+    // from a pixel of the view to the table (cm), then from the table to the picture
+    Mat view_to_table = Mat::eye(3, 3, CV_64F);
+    view_to_table.at<double>(0, 0) = 1 / RECTIFIED_PIXELS_PER_CM;
+    view_to_table.at<double>(1, 1) = 1 / RECTIFIED_PIXELS_PER_CM;
+    view_to_table.at<double>(0, 2) = -RECTIFIED_MARGIN_CM;
+    view_to_table.at<double>(1, 2) = -RECTIFIED_MARGIN_CM;
+    Mat view_to_picture = Mat(homography.inv()) * view_to_table;
+    const double* m = view_to_picture.ptr<double>(0);
+
+    Size size = rectifiedSize();
+    Mat map_x(size, CV_32F), map_y(size, CV_32F);
+    for (int v = 0; v < size.height; v++) {
+        float* row_x = map_x.ptr<float>(v);
+        float* row_y = map_y.ptr<float>(v);
+        // the numerators and the denominator are linear along a row:
+        // we only add the first column of the matrix for each pixel
+        double x = m[1] * v + m[2];
+        double y = m[4] * v + m[5];
+        double w = m[7] * v + m[8];
+        for (int u = 0; u < size.width; u++) {
+            double inv_w = fabs(w) > DBL_EPSILON ? 1 / w : 0;
+            row_x[u] = (float)(x * inv_w);
+            row_y[u] = (float)(y * inv_w);
+            x += m[0];
+            y += m[3];
+            w += m[6];
+        }
+    }
+
+    convertMaps(map_x, map_y, map1, map2, CV_16SC2);
+}
+
+/**
+    Compute the view of the table from above
+
+    @param frame The picture, from the camera used to compute the remap tables
+    @param map1 The first remap table, from initRectificationMaps
+    @param map2 The second remap table, from initRectificationMaps
+    @param rectified The output view of the table
+*/
+void rectifyTable(const Mat& frame, const Mat& map1, const Mat& map2, Mat& rectified) {
+    remap(frame, rectified, map1, map2, INTER_LINEAR, BORDER_CONSTANT, Scalar());
+}
+
+/**
+    Transform points of the picture to the table (cm) with the homography, like
+    perspectiveTransform, for 4 points at a time. The points are stored as a structure
+    of arrays, so a whole trajectory is converted in a single call
+
+    @param homography The homography from the picture to the table
+    @param points The points of the picture
+    @param transformed The output points of the table (cm)
+*/
+void transformPoints(const Mat& homography, const points_soa& points, points_soa& transformed) {
+    Mat h;
+    homography.convertTo(h, CV_32F);
+    const float* m = h.ptr<float>(0);
+
+    int n = (int)points.x.size();
+    transformed.x.resize(n);
+    transformed.y.resize(n);
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+    const __m128 m3 = _mm_set1_ps(m[3]), m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]);
+    const __m128 m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]), m8 = _mm_set1_ps(m[8]);
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 epsilon = _mm_set1_ps(FLT_EPSILON);
+    const __m128 one = _mm_set1_ps(1);
+
+    for (; i <= n - 4; i += 4) {
+        __m128 x = _mm_loadu_ps(&points.x[i]);
+        __m128 y = _mm_loadu_ps(&points.y[i]);
+        __m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m1, y)), m2);
+        __m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, x), _mm_mul_ps(m4, y)), m5);
+        __m128 w  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m6, x), _mm_mul_ps(m7, y)), m8);
+        // the points at infinity give 0, like perspectiveTransform
+        __m128 valid = _mm_cmpgt_ps(_mm_andnot_ps(sign_mask, w), epsilon);
+        __m128 inv_w = _mm_and_ps(valid, _mm_div_ps(one, w));
+        _mm_storeu_ps(&transformed.x[i], _mm_mul_ps(tx, inv_w));
+        _mm_storeu_ps(&transformed.y[i], _mm_mul_ps(ty, inv_w));
+    }
+#endif
+
+    // remaining points (or all the points, without SSE2)
+    for (; i < n; i++) {
+        float x = points.x[i], y = points.y[i];
+        float w = m[6] * x + m[7] * y + m[8];
+        float inv_w = fabsf(w) > FLT_EPSILON ? 1 / w : 0;
+        transformed.x[i] = (m[0] * x + m[1] * y + m[2]) * inv_w;
+        transformed.y[i] = (m[3] * x + m[4] * y + m[5]) * inv_w;
+    }
+}
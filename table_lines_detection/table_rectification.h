@@ -0,0 +1,30 @@
+#ifndef TABLE_RECTIFICATION_H
+#define TABLE_RECTIFICATION_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
+
+#include "line_geometry.h"
+
+using namespace cv;
+using namespace std;
+
+// size of a table tennis table (cm)
+const float TABLE_LENGTH = 274;
+const float TABLE_WIDTH = 152.5;
+
+// resolution of the view of the table from above, and margin around the table
+// (the ball can bounce near the edges)
+const float RECTIFIED_PIXELS_PER_CM = 2;
+const float RECTIFIED_MARGIN_CM = 20;
+
+
+void tableHomography(const Point2f* corners, Mat& homography);
+Size rectifiedSize();
+void initRectificationMaps(const Mat& homography, Mat& map1, Mat& map2);
+void rectifyTable(const Mat& frame, const Mat& map1, const Mat& map2, Mat& rectified);
+void transformPoints(const Mat& homography, const points_soa& points, points_soa& transformed);
+
+
+#endif
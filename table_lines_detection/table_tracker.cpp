@@ -0,0 +1,196 @@
+#include "table_tracker.h"
+#include "hough_bands.h"
+#include "line_geometry.h"
+#include "square_detection.h"
+
+#include <math.h>
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+
+// finds the corners of the table with the Hough transform (see hough-transform.cpp)
+static bool detectWithHough(const Mat& frame, Point2f* corners) {
+    Mat gray, canny;
+    cvtColor(frame, gray, CV_BGR2GRAY);
+    Canny(gray, canny, 50, 200, 3);
+
+    line_groups groups;
+    houghBands(canny, groups);
+
+    segments_soa up, down, left, right;
+    toSegments(groups.horizontal_up, up);
+    toSegments(groups.horizontal_down, down);
+    toSegments(groups.vertical_left, left);
+    toSegments(groups.vertical_right, right);
+
+    // the corners are the intersections which are the farthest from the center
+    Point2f center(frame.cols / 2, frame.rows / 2);
+    points_soa points[4];
+    intersectSegments(up, left, points[0]);
+    intersectSegments(up, right, points[1]);
+    intersectSegments(down, right, points[2]);
+    intersectSegments(down, left, points[3]);
+    for (int c = 0; c < 4; c++)
+        if (!farthestPoint(points[c], center, corners[c]))
+            return false;
+    return true;
+}
+
+static bool isHigher(const Point& a, const Point& b) {
+    return a.y < b.y;
+}
+
+// finds the corners of the table with the square detection (see detect-rectangles.cpp):
+// the table is the biggest square
+static bool detectWithSquares(const Mat& frame, Point2f* corners) {
+    vector<vector<Point> > squares;
+    findSquares(frame, squares);
+
+    int biggest = -1;
+    double area_max = 0;
+    for (size_t i = 0; i < squares.size(); i++) {
+        double area = fabs(contourArea(Mat(squares[i])));
+        if (area > area_max) {
+            area_max = area;
+            biggest = (int)i;
+        }
+    }
+    if (biggest < 0)
+        return false;
+
+    // we sort the corners: the two upper ones, then the two lower ones, each pair from left to right
+    vector<Point> square = squares[biggest];
+    sort(square.begin(), square.end(), isHigher);
+    Point left_up    = square[0].x < square[1].x ? square[0] : square[1];
+    Point right_up   = square[0].x < square[1].x ? square[1] : square[0];
+    Point left_down  = square[2].x < square[3].x ? square[2] : square[3];
+    Point right_down = square[2].x < square[3].x ? square[3] : square[2];
+    corners[0] = left_up;
+    corners[1] = right_up;
+    corners[2] = right_down;
+    corners[3] = left_down;
+    return true;
+}
+
+/**
+    Full detection of the table (slow)
+
+    @param frame The frame (BGR)
+    @param detector The detection algorithm
+    @param corners The output 4 corners: left up, right up, right down, left down
+    @return false if the table was not found
+*/
+bool detectTableCorners(const Mat& frame, TableDetector detector, Point2f* corners) {
+    if (detector == DETECTOR_SQUARES)
+        return detectWithSquares(frame, corners);
+    return detectWithHough(frame, corners);
+}
+
+/**
+    Measure how much the 4 lines of the table are still visible at the given position:
+    at a few points along each line, we compare the colors of the pixels on each side
+    of the line. Only 4 * TRACKER_SAMPLES_PER_LINE * 2 pixels are read, so it is much faster
+    than a detection
+
+    @param frame The frame (BGR)
+    @param corners The 4 corners of the table
+    @return The mean difference of color across the lines (0 to 3 * 255)
+*/
+float tableEdgeScore(const Mat& frame, const Point2f* corners) {
+    int total = 0, nb_samples = 0;
+
+    for (int c = 0; c < 4; c++) {
+        Point2f start = corners[c];
+        Point2f end = corners[(c + 1) % 4];
+        Point2f direction = end - start;
+        float length = sqrtf(direction.x * direction.x + direction.y * direction.y);
+        if (length < 1)
+            continue;
+
+        // the unit vector perpendicular to the line
+        Point2f normal(-direction.y / length, direction.x / length);
+
+        for (int s = 0; s < TRACKER_SAMPLES_PER_LINE; s++) {
+            // the samples are spread along the line, without the ends
+            Point2f p = start + direction * ((s + 0.5) / TRACKER_SAMPLES_PER_LINE);
+            Point inside (cvRound(p.x + normal.x * TRACKER_SAMPLE_OFFSET), cvRound(p.y + normal.y * TRACKER_SAMPLE_OFFSET));
+            Point outside(cvRound(p.x - normal.x * TRACKER_SAMPLE_OFFSET), cvRound(p.y - normal.y * TRACKER_SAMPLE_OFFSET));
+            if (inside.x < 0 || inside.y < 0 || inside.x >= frame.cols || inside.y >= frame.rows ||
+                outside.x < 0 || outside.y < 0 || outside.x >= frame.cols || outside.y >= frame.rows)
+                continue;
+
+            const Vec3b& a = frame.at<Vec3b>(inside);
+            const Vec3b& b = frame.at<Vec3b>(outside);
+            total += abs(a[0] - b[0]) + abs(a[1] - b[1]) + abs(a[2] - b[2]);
+            nb_samples++;
+        }
+    }
+
+    return nb_samples > 0 ? (float)total / nb_samples : 0;
+}
+
+
+TableTracker::TableTracker(TableDetector detector)
+    : nb_detections(0), last_score(0), detector(detector), reference_score(0),
+      nb_failed_frames(0), frame_number(0), last_detection_frame(-TRACKER_RETRY_INTERVAL) {}
+
+// full detection, and publication of the new geometry
+bool TableTracker::detect(const Mat& frame) {
+    nb_detections++;
+    last_detection_frame = frame_number;
+
+    Point2f corners[4];
+    if (!detectTableCorners(frame, detector, corners))
+        return false;
+
+    shared_ptr<TableGeometry> new_geometry = make_shared<TableGeometry>();
+    for (int c = 0; c < 4; c++)
+        new_geometry->corners[c] = corners[c];
+    tableHomography(corners, new_geometry->homography);
+    new_geometry->frame_number = frame_number;
+
+    // the readers get either the previous geometry or the new one, never a partial one
+    atomic_store(&current_geometry, shared_ptr<const TableGeometry>(new_geometry));
+
+    reference_score = tableEdgeScore(frame, corners);
+    last_score = reference_score;
+    nb_failed_frames = 0;
+    return true;
+}
+
+/**
+    Update the geometry of the table with a new frame: if the table is known, we only
+    check that its lines are still at the same place, and we run a full detection
+    when they have not been found during several frames
+
+    @param frame The new frame (BGR)
+    @return false if the table is unknown
+*/
+bool TableTracker::processFrame(const Mat& frame) {
+    bool found;
+    shared_ptr<const TableGeometry> known = geometry();
+
+    if (!known) {
+        // we have never found the table: we try again from time to time
+        found = (frame_number - last_detection_frame >= TRACKER_RETRY_INTERVAL) && detect(frame);
+    }
+    else {
+        last_score = tableEdgeScore(frame, known->corners);
+        if (last_score < reference_score * TRACKER_MIN_SCORE_RATIO)
+            nb_failed_frames++;
+        else
+            nb_failed_frames = 0;
+
+        // the lines are not where they were: the camera or the table has probably moved
+        // (we keep the previous geometry if the new detection fails)
+        if (nb_failed_frames >= TRACKER_MAX_FAILED_FRAMES
+            && frame_number - last_detection_frame >= TRACKER_RETRY_INTERVAL)
+            detect(frame);
+        found = true;
+    }
+
+    frame_number++;
+    return found;
+}
@@ -0,0 +1,65 @@
+#ifndef TABLE_TRACKER_H
+#define TABLE_TRACKER_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <memory>
+
+#include "table_rectification.h"
+
+using namespace cv;
+using namespace std;
+
+// the verification of the table lines: we sample the edge strength at a few points
+// along each of the 4 lines of the table
+const int TRACKER_SAMPLES_PER_LINE = 64;
+const int TRACKER_SAMPLE_OFFSET = 3;  // distance (pixels) of the pixels compared on each side of the line
+// the table has probably moved when the edge strength is less than this ratio of the
+// edge strength measured just after the detection, during several consecutive frames
+const float TRACKER_MIN_SCORE_RATIO = 0.5;
+const int TRACKER_MAX_FAILED_FRAMES = 5;
+// when the table was not found, we wait a few frames before trying again
+const int TRACKER_RETRY_INTERVAL = 15;
+
+// the algorithm used for the full detection of the table
+enum TableDetector {DETECTOR_HOUGH, DETECTOR_SQUARES};
+
+// the geometry of the table in the picture, which doesn't change until the next detection
+typedef struct {
+    Point2f corners[4];  // left up, right up, right down, left down
+    Mat homography;      // from the picture to the table (cm, origin at the left up corner)
+    int frame_number;    // the frame where the table was detected
+} TableGeometry;
+
+
+bool detectTableCorners(const Mat& frame, TableDetector detector, Point2f* corners);
+float tableEdgeScore(const Mat& frame, const Point2f* corners);
+
+// tracks the table on a video: the table is detected on the first frame, and then
+// only verified on each frame, until it seems to have moved
+class TableTracker {
+public:
+    TableTracker(TableDetector detector = DETECTOR_HOUGH);
+
+    bool processFrame(const Mat& frame);
+
+    // the last geometry of the table (NULL if the table was never found), can be called
+    // from any thread: the geometry is replaced atomically, never modified
+    shared_ptr<const TableGeometry> geometry() const { return atomic_load(&current_geometry); }
+
+    int nb_detections;     // number of full detections
+    float last_score;      // edge strength at the last frame
+
+private:
+    bool detect(const Mat& frame);
+
+    TableDetector detector;
+    shared_ptr<const TableGeometry> current_geometry;  // accessed only with atomic_load / atomic_store
+    float reference_score;     // edge strength just after the last detection
+    int nb_failed_frames;      // consecutive frames where the edge strength was too low
+    int frame_number;
+    int last_detection_frame;
+};
+
+
+#endif